@@ -1,6 +1,6 @@
+use crate::matcher::PhraseMatcher;
 use serde::Deserialize;
 use std::collections::BTreeMap;
-use trie_rs::TrieBuilder;
 
 #[derive(Deserialize)]
 pub struct RawConfig {
@@ -10,11 +10,19 @@ pub struct RawConfig {
     pub actions: Vec<RawBinding>,
     pub ollama_model: String,
     pub ollama_endpoint: String,
+    #[serde(default)]
+    pub ollama_warm_up: bool,
+    #[serde(default)]
+    pub ollama_speculate: bool,
+    #[serde(default)]
+    pub recognition_server: Option<String>,
 }
 
 #[derive(Clone, Debug)]
 pub enum Action {
-    Keys(String),
+    /// Index of the binding's phrase in [`Config::key_phrases`], which the
+    /// daemon knows the chord by
+    Keys(u16),
     Command(Vec<String>),
 }
 
@@ -35,12 +43,23 @@ pub struct RawBinding {
 
 pub struct Config {
     pub actions: BTreeMap<String, Action>,
-    pub word_trie: trie_rs::Trie<u8>,
+    pub action_matcher: PhraseMatcher,
     pub keys: Vec<String>,
-    pub abstract_triggers: trie_rs::Trie<u8>,
+    /// Phrases of the keys actions, sent to the daemon once per connection
+    pub key_phrases: Vec<String>,
+    pub mode_matcher: PhraseMatcher,
     pub modes: BTreeMap<String, Mode>,
     pub ollama_model: String,
     pub ollama_endpoint: String,
+    /// Load the Ollama model at startup and whenever the infer phrase is
+    /// heard, so that the first reply doesn't wait for it
+    pub ollama_warm_up: bool,
+    /// Send the prompt to Ollama when speech pauses, before it is final.
+    /// The request is dropped if the final prompt differs
+    pub ollama_speculate: bool,
+    /// If set, speech is recognized by `tempest-client serve` at this
+    /// address, and only features are computed here
+    pub recognition_server: Option<String>,
 }
 
 #[derive(Clone, Copy, PartialEq, Eq)]
@@ -56,35 +75,31 @@ impl From<RawConfig> for Config {
         let wake_phrase = value.wake_phrase.to_lowercase();
         let rest_phrase = value.rest_phrase.to_lowercase();
         let infer_phrase = value.infer_phrase.to_lowercase();
-        let mut trie_builder = TrieBuilder::new();
-        for phrase in value.actions.iter().map(|b| b.phrase.to_lowercase()) {
-            trie_builder.push(phrase);
-        }
-        let word_trie = trie_builder.build();
+        let action_matcher =
+            PhraseMatcher::new(value.actions.iter().map(|b| b.phrase.to_lowercase()));
         let keys = value
             .actions
             .iter()
             .map(|b| b.phrase.to_lowercase())
             .collect();
+        let mut key_phrases = Vec::new();
         let actions = value
             .actions
             .into_iter()
             .map(|b| {
                 let action = match b.action {
                     RawAction::Command(v) => Action::Command(v),
-                    RawAction::Keys(_) => Action::Keys(b.phrase.to_lowercase()),
+                    RawAction::Keys(_) => {
+                        key_phrases.push(b.phrase.to_lowercase());
+                        Action::Keys(key_phrases.len() as u16 - 1)
+                    }
                 };
 
                 (b.phrase.to_lowercase(), action)
             })
             .collect();
 
-        let mut trie_builder = TrieBuilder::new();
-        trie_builder.push(wake_phrase.clone());
-        trie_builder.push(rest_phrase.clone());
-        trie_builder.push(infer_phrase.clone());
-
-        let abstract_triggers = trie_builder.build();
+        let mode_matcher = PhraseMatcher::new([&wake_phrase, &rest_phrase, &infer_phrase]);
         let modes = [
             (wake_phrase, Mode::Wake),
             (rest_phrase, Mode::Rest),
@@ -94,13 +109,17 @@ impl From<RawConfig> for Config {
         .collect();
 
         Self {
-            abstract_triggers,
+            mode_matcher,
             modes,
             keys,
+            key_phrases,
             actions,
-            word_trie,
+            action_matcher,
             ollama_model: value.ollama_model,
             ollama_endpoint: value.ollama_endpoint,
+            ollama_warm_up: value.ollama_warm_up,
+            ollama_speculate: value.ollama_speculate,
+            recognition_server: value.recognition_server,
         }
     }
 }
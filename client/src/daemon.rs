@@ -0,0 +1,118 @@
+use aes_gcm::{
+    aead::{Aead, OsRng},
+    AeadCore, Aes256Gcm, Key, KeyInit,
+};
+use anyhow::{anyhow, bail, Result};
+use std::os::unix::net::UnixStream;
+use tempest_protocol::{read_frame, write_frame, ACCEPTED, CHALLENGE_SIZE, NONCE_SIZE};
+
+pub const SOCKET_PATH: &str = "/run/tempest.socket";
+
+/// An authenticated connection to `tempest-daemon`. The token is only used
+/// for the handshake, after which chords are sent as compact ids.
+pub struct DaemonConnection {
+    stream: UnixStream,
+    phrases: Vec<String>,
+    frame: Vec<u8>,
+}
+
+impl DaemonConnection {
+    /// Connects and authenticates with the hex encoded token printed by the
+    /// daemon, agreeing that chord n is `phrases[n]`.
+    pub fn connect(path: &str, token: &str, phrases: Vec<String>) -> Result<Self> {
+        Self::handshake(UnixStream::connect(path)?, token, phrases)
+    }
+
+    fn handshake(mut stream: UnixStream, token: &str, phrases: Vec<String>) -> Result<Self> {
+        let key_bytes = hex::decode(token.as_bytes())?;
+        if key_bytes.len() != 32 {
+            bail!("the token should be 64 hex digits");
+        }
+        let cipher = Aes256Gcm::new(Key::<Aes256Gcm>::from_slice(&key_bytes));
+
+        let mut challenge = Vec::new();
+        if !read_frame(&mut stream, &mut challenge)? || challenge.len() != CHALLENGE_SIZE {
+            bail!("the daemon sent no challenge");
+        }
+
+        let mut handshake = challenge;
+        for phrase in &phrases {
+            handshake.extend_from_slice(phrase.as_bytes());
+            handshake.push(b'\n');
+        }
+        let nonce = Aes256Gcm::generate_nonce(&mut OsRng);
+        let ciphertext = cipher
+            .encrypt(&nonce, handshake.as_slice())
+            .map_err(|e| anyhow!("failed to encrypt the handshake: {e}"))?;
+        let mut frame = Vec::with_capacity(NONCE_SIZE + ciphertext.len());
+        frame.extend_from_slice(&nonce);
+        frame.extend_from_slice(&ciphertext);
+        write_frame(&mut stream, &frame)?;
+
+        // The daemon hangs up on a wrong token
+        if !read_frame(&mut stream, &mut frame)? || frame.as_slice() != [ACCEPTED] {
+            bail!("the daemon rejected the token");
+        }
+        Ok(Self {
+            stream,
+            phrases,
+            frame: Vec::new(),
+        })
+    }
+
+    /// Performs the chords in order. They reach the daemon in one frame, and
+    /// the compositor as one input report.
+    pub fn send_chords(&mut self, ids: &[u16]) {
+        self.frame.clear();
+        self.frame
+            .extend(ids.iter().flat_map(|id| id.to_le_bytes()));
+        if let Err(e) = write_frame(&mut self.stream, &self.frame) {
+            let phrases: Vec<&str> = ids
+                .iter()
+                .filter_map(|&id| self.phrases.get(id as usize))
+                .map(String::as_str)
+                .collect();
+            log::error!("failed to send keyboard shortcuts {phrases:?} to daemon socket: {e}");
+            log::error!(
+                "please make sure the daemon is running as a member of the input / uinput group"
+            );
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use aes_gcm::Nonce;
+    use std::thread;
+
+    #[test]
+    fn test_handshake_then_batched_ids() {
+        let token = "11".repeat(32);
+        let (client, mut daemon) = UnixStream::pair().unwrap();
+
+        let daemon = thread::spawn(move || {
+            let challenge = [7u8; CHALLENGE_SIZE];
+            write_frame(&mut daemon, &challenge).unwrap();
+
+            let mut frame = Vec::new();
+            assert!(read_frame(&mut daemon, &mut frame).unwrap());
+            let cipher = Aes256Gcm::new(Key::<Aes256Gcm>::from_slice(&[0x11; 32]));
+            let (nonce, ciphertext) = frame.split_at(NONCE_SIZE);
+            let handshake = cipher
+                .decrypt(Nonce::from_slice(nonce), ciphertext)
+                .unwrap();
+            assert_eq!(&handshake[..CHALLENGE_SIZE], &challenge);
+            assert_eq!(&handshake[CHALLENGE_SIZE..], b"focus up\nfocus down\n");
+            write_frame(&mut daemon, &[ACCEPTED]).unwrap();
+
+            assert!(read_frame(&mut daemon, &mut frame).unwrap());
+            frame
+        });
+
+        let phrases = vec!["focus up".to_string(), "focus down".to_string()];
+        let mut connection = DaemonConnection::handshake(client, &token, phrases).unwrap();
+        connection.send_chords(&[1, 0, 1]);
+        assert_eq!(daemon.join().unwrap(), [1, 0, 0, 0, 1, 0]);
+    }
+}
@@ -0,0 +1,148 @@
+use anyhow::{bail, Result};
+use candle_core::{safetensors, Device, Tensor};
+use std::collections::HashMap;
+use std::fs;
+use std::path::{Path, PathBuf};
+
+const TENSOR_NAME: &str = "embeddings";
+const FILE_PREFIX: &str = "actions-";
+
+/// Embeddings of the configured action phrases, one L2 normalized row per
+/// phrase. They are kept on disk keyed by the phrases and the BERT model, so
+/// startup only runs BERT when `config.yml` or the model changes.
+pub struct EmbeddingIndex {
+    embeddings: Tensor,
+}
+
+impl EmbeddingIndex {
+    pub fn load_or_build(
+        dir: &Path,
+        model_id: &str,
+        revision: &str,
+        keys: &[String],
+        device: &Device,
+        build: impl FnOnce() -> Result<Tensor>,
+    ) -> Result<Self> {
+        let path = index_path(dir, model_id, revision, keys);
+        match Self::load(&path, keys.len(), device) {
+            Ok(index) => {
+                log::debug!("loaded action embeddings from {}", path.display());
+                return Ok(index);
+            }
+            Err(e) if path.exists() => {
+                log::warn!("rebuilding action embeddings, {}: {e}", path.display())
+            }
+            Err(_) => log::info!("computing embeddings of {} actions", keys.len()),
+        }
+
+        let index = Self {
+            embeddings: build()?,
+        };
+        if let Err(e) = index.save(dir, &path) {
+            log::warn!(
+                "unable to save action embeddings to {}: {e}",
+                path.display()
+            );
+        }
+        Ok(index)
+    }
+
+    fn load(path: &Path, rows: usize, device: &Device) -> Result<Self> {
+        let tensors = unsafe { safetensors::MmapedSafetensors::new(path)? };
+        let embeddings = tensors.load(TENSOR_NAME, device)?;
+        if embeddings.dims2()?.0 != rows {
+            bail!("index has {:?} rows, expected {rows}", embeddings.dims());
+        }
+        Ok(Self { embeddings })
+    }
+
+    fn save(&self, dir: &Path, path: &Path) -> Result<()> {
+        fs::create_dir_all(dir)?;
+        // Indexes of older configurations are never loaded again
+        for entry in fs::read_dir(dir)? {
+            let stale = entry?.path();
+            let is_index = stale
+                .file_name()
+                .and_then(|name| name.to_str())
+                .is_some_and(|name| name.starts_with(FILE_PREFIX));
+            if is_index && stale != path {
+                let _ = fs::remove_file(stale);
+            }
+        }
+
+        let tensors = HashMap::from([(TENSOR_NAME.to_string(), self.embeddings.clone())]);
+        safetensors::save(&tensors, path)?;
+        Ok(())
+    }
+
+    /// Returns the row most similar to the L2 normalized `target` and its
+    /// cosine similarity, as one matrix-vector product over all rows.
+    pub fn best_match(&self, target: &Tensor) -> Result<Option<(usize, f32)>> {
+        let similarities = self
+            .embeddings
+            .matmul(&target.unsqueeze(1)?)?
+            .squeeze(1)?
+            .to_vec1::<f32>()?;
+
+        Ok(similarities
+            .into_iter()
+            .enumerate()
+            .max_by(|u, v| u.1.total_cmp(&v.1)))
+    }
+}
+
+// FNV-1a, as the file name must stay the same across builds
+fn hash_bytes(hash: u64, bytes: &[u8]) -> u64 {
+    bytes.iter().fold(hash, |hash, &byte| {
+        (hash ^ byte as u64).wrapping_mul(0x100000001b3)
+    })
+}
+
+fn index_path(dir: &Path, model_id: &str, revision: &str, keys: &[String]) -> PathBuf {
+    let mut hash: u64 = 0xcbf29ce484222325;
+    for part in [model_id, revision]
+        .into_iter()
+        .chain(keys.iter().map(|k| k.as_str()))
+    {
+        // The terminator keeps ["ab", "c"] and ["a", "bc"] apart
+        hash = hash_bytes(hash, part.as_bytes());
+        hash = hash_bytes(hash, &[0]);
+    }
+    dir.join(format!("{FILE_PREFIX}{hash:016x}.safetensors"))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_index_round_trips_and_tracks_keys() {
+        let dir = std::env::temp_dir().join(format!("tempest-index-{}", std::process::id()));
+        let keys = vec!["open browser".to_string(), "close window".to_string()];
+        let rows = Tensor::new(&[[1f32, 0.0], [0.0, 1.0]], &Device::Cpu).unwrap();
+
+        let built =
+            EmbeddingIndex::load_or_build(&dir, "m", "r", &keys, &Device::Cpu, || Ok(rows.clone()))
+                .unwrap();
+        let loaded = EmbeddingIndex::load_or_build(&dir, "m", "r", &keys, &Device::Cpu, || {
+            panic!("the index should have been loaded")
+        })
+        .unwrap();
+
+        let target = Tensor::new(&[0.6f32, 0.8], &Device::Cpu).unwrap();
+        assert_eq!(built.best_match(&target).unwrap().unwrap().0, 1);
+        assert_eq!(loaded.best_match(&target).unwrap().unwrap().0, 1);
+
+        let other = vec!["open".to_string(), " browser".to_string()];
+        assert_ne!(
+            index_path(&dir, "m", "r", &keys),
+            index_path(&dir, "m", "r", &other)
+        );
+        assert_ne!(
+            index_path(&dir, "m", "r", &keys),
+            index_path(&dir, "m", "r2", &keys)
+        );
+
+        fs::remove_dir_all(&dir).unwrap();
+    }
+}
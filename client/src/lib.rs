@@ -21,9 +21,12 @@
 //! This module provides a Rust interface for interacting with the April ASR library,
 //! allowing developers to leverage speech-to-text capabilities in Rust applications.
 use aprilasr_sys::ffi as afi;
-use std::ffi::{c_char, c_float, c_int, CStr, CString};
+use std::ffi::{c_char, c_float, c_int, c_void, CStr, CString};
+use std::marker::PhantomData;
 use std::panic::{catch_unwind, AssertUnwindSafe};
+use std::sync::atomic::{AtomicBool, Ordering};
 use std::sync::mpsc::Sender;
+use std::sync::Arc;
 use std::{fmt, process, slice};
 
 /// Exposes the April API version as defined by the FFI cast to `i32`.
@@ -93,6 +96,68 @@ impl Model {
         }
     }
 
+    /// Instantiate an April ASR model given a file path and runtime options.
+    ///
+    /// All models in a process share one ONNX Runtime environment, so models
+    /// created with [`ModelOptions::global_thread_pool`] also share one set
+    /// of threads.
+    ///
+    /// # Arguments
+    ///
+    /// * `model_path` - The file path to the April ASR model.
+    /// * `options` - The runtime options, see [`ModelOptions`].
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the model cannot be created from the provided file path.
+    pub fn with_options(
+        model_path: &str,
+        options: &ModelOptions,
+    ) -> Result<Model, Box<dyn std::error::Error>> {
+        let path = CString::new(model_path)?;
+        let cache_dir = match &options.optimized_model_cache_dir {
+            Some(dir) => Some(CString::new(dir.as_str())?),
+            None => None,
+        };
+        let openvino_device_type = match &options.openvino_device_type {
+            Some(device) => Some(CString::new(device.as_str())?),
+            None => None,
+        };
+
+        let mut execution_providers = [[afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_CPU;
+            MAX_EXECUTION_PROVIDERS]; NETWORK_COUNT];
+        for (network, providers) in options.execution_providers.iter().enumerate() {
+            for (slot, provider) in providers.iter().take(MAX_EXECUTION_PROVIDERS).enumerate() {
+                execution_providers[network][slot] = (*provider).into();
+            }
+        }
+
+        let ffi_options = afi::AprilModelOptions {
+            intra_op_threads: options.intra_op_threads as c_int,
+            inter_op_threads: options.inter_op_threads as c_int,
+            use_global_thread_pool: options.global_thread_pool as c_int,
+            graph_optimization_level: options.graph_optimization_level.into(),
+            optimized_model_cache_dir: cache_dir
+                .as_ref()
+                .map_or(std::ptr::null(), |dir| dir.as_ptr()),
+            network_precision: options.network_precision.into(),
+            execution_providers,
+            openvino_device_type: openvino_device_type
+                .as_ref()
+                .map_or(std::ptr::null(), |device| device.as_ptr()),
+            cuda_device_id: options.cuda_device_id as c_int,
+            warm_up: options.warm_up as c_int,
+        };
+
+        let model = unsafe { afi::aam_create_model_ex(path.as_ptr(), ffi_options) };
+
+        if model.is_null() {
+            Err("Failed to create ASR model".into())
+        } else {
+            Ok(Model { ctx: model })
+        }
+    }
+
     /// Get the name of the model.
     ///
     /// # Safety
@@ -124,8 +189,79 @@ impl Model {
     pub fn sample_rate(&self) -> usize {
         unsafe { afi::aam_get_sample_rate(self.ctx) }
     }
+
+    /// Returns whether the model carries a wake word network, needed by
+    /// [`SessionOptions::wake_word`].
+    pub fn has_wake_network(&self) -> bool {
+        unsafe { afi::aam_has_wake_network(self.ctx) }
+    }
+
+    /// Returns the execution provider the given network ended up running on.
+    /// See [`ModelOptions::execution_providers`].
+    pub fn execution_provider(&self, network: Network) -> ExecutionProvider {
+        unsafe { afi::aam_get_execution_provider(self.ctx, network.into()) }.into()
+    }
+
+    /// Returns how long creating the model took, see [`LoadStats`].
+    pub fn load_stats(&self) -> LoadStats {
+        let stats = unsafe { afi::aam_get_load_stats(self.ctx) };
+        LoadStats {
+            network_load_ms: stats.network_load_ms,
+            network_warm_up_ms: stats.network_warm_up_ms,
+            total_ms: stats.total_ms,
+        }
+    }
+
+    /// Transcribes a whole recording, sharding it across threads. See
+    /// [`TranscribeOptions`]. The audio must be single-channel and sampled at
+    /// [`Model::sample_rate`]. Blocks until done.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if transcription failed.
+    pub fn transcribe_pcm16(
+        &self,
+        pcm16: &[i16],
+        options: &TranscribeOptions,
+    ) -> Result<Transcript, Box<dyn std::error::Error>> {
+        let transcript = unsafe {
+            afi::aas_transcribe_pcm16(self.ctx, pcm16.as_ptr(), pcm16.len(), options.into())
+        };
+        Transcript::from_raw(transcript)
+    }
+
+    /// Same as [`Model::transcribe_pcm16`], reading the audio from a WAV file
+    /// of 16-bit integer or 32-bit float samples at [`Model::sample_rate`].
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the file can't be read or transcription failed.
+    pub fn transcribe_file(
+        &self,
+        wav_path: &str,
+        options: &TranscribeOptions,
+    ) -> Result<Transcript, Box<dyn std::error::Error>> {
+        let path = CString::new(wav_path)?;
+        let transcript =
+            unsafe { afi::aas_transcribe_file(self.ctx, path.as_ptr(), options.into()) };
+        Transcript::from_raw(transcript)
+    }
+
+    /// Returns statistics summed over all of the model's sessions, including
+    /// ones which have since been freed. The buffer fields are summed over
+    /// live sessions only.
+    pub fn stats(&self) -> Stats {
+        unsafe { afi::aam_get_stats(self.ctx) }.into()
+    }
 }
 
+// SAFETY: The model is only written while it is created and freed. Its
+// sessions otherwise only read it and run its networks, which ONNX Runtime
+// allows from several threads at once. What they do share, the decoder
+// cache, the list of live sessions and the summed statistics, is locked
+unsafe impl Send for Model {}
+unsafe impl Sync for Model {}
+
 /// Implementation of the `Drop` trait for the `Model` struct.
 ///
 /// The `Drop` trait defines a method named `drop` that is called when the value
@@ -146,6 +282,450 @@ impl Drop for Model {
     }
 }
 
+/// Level of graph optimization ONNX Runtime applies to the model's networks.
+#[derive(Debug, Copy, Clone, PartialEq, Default)]
+pub enum GraphOptimizationLevel {
+    /// Use the ONNX Runtime default, which enables all optimizations.
+    #[default]
+    Default,
+
+    /// Disable all optimizations.
+    DisableAll,
+
+    /// Enable basic optimizations, such as constant folding.
+    Basic,
+
+    /// Enable basic optimizations and complex node fusions.
+    Extended,
+
+    /// Enable all optimizations, including layout optimizations.
+    All,
+}
+
+impl From<GraphOptimizationLevel> for afi::AprilGraphOptimizationLevel {
+    fn from(val: GraphOptimizationLevel) -> Self {
+        match val {
+            GraphOptimizationLevel::Default => {
+                afi::AprilGraphOptimizationLevel_APRIL_GRAPH_OPTIMIZATION_DEFAULT
+            }
+            GraphOptimizationLevel::DisableAll => {
+                afi::AprilGraphOptimizationLevel_APRIL_GRAPH_OPTIMIZATION_DISABLE_ALL
+            }
+            GraphOptimizationLevel::Basic => {
+                afi::AprilGraphOptimizationLevel_APRIL_GRAPH_OPTIMIZATION_BASIC
+            }
+            GraphOptimizationLevel::Extended => {
+                afi::AprilGraphOptimizationLevel_APRIL_GRAPH_OPTIMIZATION_EXTENDED
+            }
+            GraphOptimizationLevel::All => {
+                afi::AprilGraphOptimizationLevel_APRIL_GRAPH_OPTIMIZATION_ALL
+            }
+        }
+    }
+}
+
+/// Precision of the network variants a [`Model`] runs.
+///
+/// Model files may carry fp32, fp16 and int8 variants of each network,
+/// tagged with the CPU features they need.
+#[derive(Debug, Copy, Clone, PartialEq, Default)]
+pub enum NetworkPrecision {
+    /// Use the fastest variant of each network that this CPU supports.
+    #[default]
+    Auto,
+
+    /// Prefer full precision variants.
+    Fp32,
+
+    /// Prefer half precision variants.
+    Fp16,
+
+    /// Prefer dynamically quantized 8-bit variants.
+    Int8,
+}
+
+impl From<NetworkPrecision> for afi::AprilNetworkPrecision {
+    fn from(val: NetworkPrecision) -> Self {
+        match val {
+            NetworkPrecision::Auto => afi::AprilNetworkPrecision_APRIL_NETWORK_PRECISION_AUTO,
+            NetworkPrecision::Fp32 => afi::AprilNetworkPrecision_APRIL_NETWORK_PRECISION_FP32,
+            NetworkPrecision::Fp16 => afi::AprilNetworkPrecision_APRIL_NETWORK_PRECISION_FP16,
+            NetworkPrecision::Int8 => afi::AprilNetworkPrecision_APRIL_NETWORK_PRECISION_INT8,
+        }
+    }
+}
+
+/// The networks making up a [`Model`].
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub enum Network {
+    Encoder,
+    Decoder,
+    Joiner,
+
+    /// Only present in models with a wake word spotter.
+    Wake,
+}
+
+const NETWORK_COUNT: usize = 4;
+const MAX_EXECUTION_PROVIDERS: usize = afi::APRIL_MAX_EXECUTION_PROVIDERS as usize;
+
+impl From<Network> for afi::AprilNetwork {
+    fn from(val: Network) -> Self {
+        match val {
+            Network::Encoder => afi::AprilNetwork_APRIL_NETWORK_ENCODER,
+            Network::Decoder => afi::AprilNetwork_APRIL_NETWORK_DECODER,
+            Network::Joiner => afi::AprilNetwork_APRIL_NETWORK_JOINER,
+            Network::Wake => afi::AprilNetwork_APRIL_NETWORK_WAKE,
+        }
+    }
+}
+
+/// ONNX Runtime execution providers a network may run on.
+///
+/// Providers other than the CPU are only usable if the ONNX Runtime library
+/// in use was built with them. Nodes a provider can't run still fall back to
+/// the CPU within the network.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Default)]
+pub enum ExecutionProvider {
+    #[default]
+    Cpu,
+    Xnnpack,
+    OpenVino,
+    Cuda,
+    CoreMl,
+}
+
+impl From<ExecutionProvider> for afi::AprilExecutionProvider {
+    fn from(val: ExecutionProvider) -> Self {
+        match val {
+            ExecutionProvider::Cpu => afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_CPU,
+            ExecutionProvider::Xnnpack => {
+                afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_XNNPACK
+            }
+            ExecutionProvider::OpenVino => {
+                afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_OPENVINO
+            }
+            ExecutionProvider::Cuda => afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_CUDA,
+            ExecutionProvider::CoreMl => {
+                afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_COREML
+            }
+        }
+    }
+}
+
+impl From<afi::AprilExecutionProvider> for ExecutionProvider {
+    fn from(val: afi::AprilExecutionProvider) -> Self {
+        match val {
+            afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_XNNPACK => {
+                ExecutionProvider::Xnnpack
+            }
+            afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_OPENVINO => {
+                ExecutionProvider::OpenVino
+            }
+            afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_CUDA => ExecutionProvider::Cuda,
+            afi::AprilExecutionProvider_APRIL_EXECUTION_PROVIDER_COREML => {
+                ExecutionProvider::CoreMl
+            }
+            _ => ExecutionProvider::Cpu,
+        }
+    }
+}
+
+/// Runtime options for creating a [`Model`] with [`Model::with_options`].
+///
+/// The default options are equivalent to [`Model::new`]: one intra-op and
+/// one inter-op thread per network, no global thread pool, default graph
+/// optimization, no optimized model cache, and every network on the CPU.
+#[derive(Debug, Clone, PartialEq, Default)]
+pub struct ModelOptions {
+    intra_op_threads: usize,
+    inter_op_threads: usize,
+    global_thread_pool: bool,
+    graph_optimization_level: GraphOptimizationLevel,
+    optimized_model_cache_dir: Option<String>,
+    network_precision: NetworkPrecision,
+    execution_providers: [Vec<ExecutionProvider>; NETWORK_COUNT],
+    openvino_device_type: Option<String>,
+    cuda_device_id: i32,
+    warm_up: bool,
+}
+
+impl ModelOptions {
+    /// Creates a new `ModelOptions` with default values.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Sets the number of threads used within a single network call.
+    /// When the global thread pool is used, this sizes the global pool instead,
+    /// and only the first model to create it decides its size.
+    pub fn intra_op_threads(mut self, threads: usize) -> Self {
+        self.intra_op_threads = threads;
+        self
+    }
+
+    /// Sets the number of threads used to run independent nodes of a network in parallel.
+    pub fn inter_op_threads(mut self, threads: usize) -> Self {
+        self.inter_op_threads = threads;
+        self
+    }
+
+    /// Runs the model's networks on the process-wide thread pool shared by
+    /// all models that set this, instead of threads of their own.
+    pub fn global_thread_pool(mut self, enabled: bool) -> Self {
+        self.global_thread_pool = enabled;
+        self
+    }
+
+    /// Sets the graph optimization level.
+    pub fn graph_optimization_level(mut self, level: GraphOptimizationLevel) -> Self {
+        self.graph_optimization_level = level;
+        self
+    }
+
+    /// Sets an existing directory in which optimized networks are saved on first
+    /// load and loaded from afterwards, skipping graph optimization.
+    pub fn optimized_model_cache_dir(mut self, dir: &str) -> Self {
+        self.optimized_model_cache_dir = Some(dir.to_string());
+        self
+    }
+
+    /// Prefers network variants of the given precision where the model file
+    /// has them and this CPU supports them, instead of the fastest variant.
+    pub fn network_precision(mut self, precision: NetworkPrecision) -> Self {
+        self.network_precision = precision;
+        self
+    }
+
+    /// Sets the execution providers to try for every network, in order of
+    /// preference. If a provider is unavailable or a network fails to load on
+    /// it, the next one is tried, and the CPU is always tried last. At most
+    /// four providers are used, and the list ends at the first
+    /// [`ExecutionProvider::Cpu`]. Use [`Model::execution_provider`] to find
+    /// where each network ended up.
+    pub fn execution_providers(mut self, providers: &[ExecutionProvider]) -> Self {
+        for list in self.execution_providers.iter_mut() {
+            *list = providers.to_vec();
+        }
+        self
+    }
+
+    /// Sets the execution providers to try for one network, for example to
+    /// run the encoder on an accelerator while the small decoder and joiner
+    /// stay on the CPU. See [`ModelOptions::execution_providers`].
+    pub fn network_execution_providers(
+        mut self,
+        network: Network,
+        providers: &[ExecutionProvider],
+    ) -> Self {
+        self.execution_providers[afi::AprilNetwork::from(network) as usize] = providers.to_vec();
+        self
+    }
+
+    /// Sets the OpenVINO device to run on, such as `"GPU"` or `"NPU"`.
+    pub fn openvino_device_type(mut self, device: &str) -> Self {
+        self.openvino_device_type = Some(device.to_string());
+        self
+    }
+
+    /// Sets the CUDA device to run on.
+    pub fn cuda_device_id(mut self, device_id: i32) -> Self {
+        self.cuda_device_id = device_id;
+        self
+    }
+
+    /// Runs each network once while the model is created, so the first
+    /// audio doesn't pay for ONNX Runtime's lazy setup. Creating the model
+    /// takes longer, and the first result comes sooner.
+    pub fn warm_up(mut self, enabled: bool) -> Self {
+        self.warm_up = enabled;
+        self
+    }
+}
+
+/// Options for [`Model::transcribe_pcm16`] and [`Model::transcribe_file`].
+///
+/// The audio is cut into shards at quiet points, and each shard is
+/// recognized by its own synchronous session on a pool of threads, so the
+/// time taken scales down with the number of cores.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct TranscribeOptions {
+    threads: usize,
+    shard_length_ms: usize,
+    beam_size: Option<usize>,
+    vad: bool,
+}
+
+impl TranscribeOptions {
+    /// Creates options with the defaults: one thread per core and 30 second shards.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Sets the number of worker threads, 0 for one per core.
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets the target shard length in milliseconds, 0 for the library default.
+    pub fn shard_length_ms(mut self, ms: usize) -> Self {
+        self.shard_length_ms = ms;
+        self
+    }
+
+    /// Decodes with beam search, keeping `beam_size` hypotheses (0 for the
+    /// library default).
+    pub fn beam_search(mut self, beam_size: usize) -> Self {
+        self.beam_size = Some(beam_size);
+        self
+    }
+
+    /// Skips recognition of audio without speech.
+    pub fn voice_activity_detection(mut self, enabled: bool) -> Self {
+        self.vad = enabled;
+        self
+    }
+}
+
+impl From<&TranscribeOptions> for afi::AprilTranscribeConfig {
+    fn from(val: &TranscribeOptions) -> Self {
+        let mut flags: afi::AprilConfigFlagBits = 0;
+        if val.beam_size.is_some() {
+            flags |= afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_BEAM_SEARCH_BIT;
+        }
+        if val.vad {
+            flags |= afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_VAD_BIT;
+        }
+
+        afi::AprilTranscribeConfig {
+            num_threads: val.threads,
+            shard_length_ms: val.shard_length_ms,
+            flags,
+            beam_size: val.beam_size.unwrap_or(0),
+        }
+    }
+}
+
+/// The result of [`Model::transcribe_pcm16`] or [`Model::transcribe_file`].
+#[derive(Debug, Clone)]
+pub struct Transcript {
+    /// The final tokens of the whole recording, timed from its start.
+    pub tokens: Vec<Token>,
+    /// Number of shards the audio was split into.
+    pub shard_count: usize,
+    /// Number of threads which ran the shards.
+    pub thread_count: usize,
+    /// Length of the audio.
+    pub audio_seconds: f64,
+    /// Time taken to transcribe it.
+    pub elapsed_seconds: f64,
+    /// `elapsed_seconds / audio_seconds`, less than 1 is faster than realtime.
+    pub real_time_factor: f64,
+}
+
+impl Transcript {
+    fn from_raw(
+        transcript: *mut afi::AprilTranscript,
+    ) -> Result<Transcript, Box<dyn std::error::Error>> {
+        if transcript.is_null() {
+            return Err("Failed to transcribe audio".into());
+        }
+
+        let result = unsafe {
+            let raw = &*transcript;
+            let tokens = if raw.token_count > 0 {
+                slice::from_raw_parts(raw.tokens, raw.token_count)
+                    .iter()
+                    .map(|t| (*t).into())
+                    .collect()
+            } else {
+                Vec::new()
+            };
+
+            Transcript {
+                tokens,
+                shard_count: raw.shard_count,
+                thread_count: raw.thread_count,
+                audio_seconds: raw.audio_seconds,
+                elapsed_seconds: raw.elapsed_seconds,
+                real_time_factor: raw.real_time_factor,
+            }
+        };
+
+        unsafe { afi::aas_free_transcript(transcript) };
+        Ok(result)
+    }
+}
+
+/// Computes a model's features from audio without loading its networks, so
+/// that a device too slow to run them can stream them to a [`Session`]
+/// elsewhere, see [`Session::feed_features`]. Each frame of features is
+/// quantized to a byte per mel bin, which takes a fraction of the bandwidth
+/// of the audio.
+#[derive(Debug)]
+pub struct FeatureExtractor {
+    ctx: *mut afi::AprilFeatureExtractor_i,
+}
+
+// Used by one thread at a time, as it needs `&mut self` to change
+unsafe impl Send for FeatureExtractor {}
+
+impl FeatureExtractor {
+    /// Reads the parameters of the model at `model_path`. Audio is fed at
+    /// `input_sample_rate` and resampled to the model's rate, or at the
+    /// model's rate if it is 0.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if the model's parameters can't be read.
+    pub fn new(
+        model_path: &str,
+        input_sample_rate: usize,
+    ) -> Result<FeatureExtractor, Box<dyn std::error::Error>> {
+        let path = CString::new(model_path)?;
+        let extractor = unsafe { afi::afe_create(path.as_ptr(), input_sample_rate) };
+
+        if extractor.is_null() {
+            Err("Failed to create feature extractor".into())
+        } else {
+            Ok(FeatureExtractor { ctx: extractor })
+        }
+    }
+
+    /// Returns the sample rate audio is fed at.
+    pub fn sample_rate(&self) -> usize {
+        unsafe { afi::afe_get_sample_rate(self.ctx) }
+    }
+
+    /// Returns the bytes taken by one frame of features.
+    pub fn frame_size(&self) -> usize {
+        unsafe { afi::afe_frame_size(self.ctx) }
+    }
+
+    /// Feeds single-channel float samples in `[-1.0, 1.0]`.
+    pub fn feed_float(&mut self, samples: &[f32]) {
+        unsafe { afi::afe_feed_float(self.ctx, samples.as_ptr(), samples.len()) };
+    }
+
+    /// Feeds single-channel PCM16 samples.
+    pub fn feed_pcm16(&mut self, samples: &[i16]) {
+        unsafe { afi::afe_feed_pcm16(self.ctx, samples.as_ptr(), samples.len()) };
+    }
+
+    /// Moves as many whole frames as fit into `data`, oldest first, and
+    /// returns the number of bytes written. Frames not read are kept.
+    pub fn read_frames(&mut self, data: &mut [u8]) -> usize {
+        unsafe { afi::afe_read_frames(self.ctx, data.as_mut_ptr() as *mut c_void, data.len()) }
+    }
+}
+
+impl Drop for FeatureExtractor {
+    fn drop(&mut self) {
+        unsafe { afi::afe_free(self.ctx) };
+    }
+}
+
 /// Represents flag bits associated with speech recognition result tokens.
 ///
 /// This enum provides information about specific characteristics associated with
@@ -174,21 +754,27 @@ pub enum TokenFlagBits {
     SentenceEnd,
 }
 
+impl TokenFlagBits {
+    /// Decodes the library's flag bits, as given by [`TokenView::flag_bits`].
+    /// Only one flag is kept, so a token which both starts a word and ends a
+    /// sentence is `SentenceEnd`. Unknown bits are ignored.
+    pub fn from_bits(bits: u32) -> Self {
+        let bits = bits as afi::AprilTokenFlagBits;
+        if bits & afi::AprilTokenFlagBits_APRIL_TOKEN_FLAG_SENTENCE_END_BIT != 0 {
+            TokenFlagBits::SentenceEnd
+        } else if bits & afi::AprilTokenFlagBits_APRIL_TOKEN_FLAG_WORD_BOUNDARY_BIT != 0 {
+            TokenFlagBits::WordBoundary
+        } else {
+            TokenFlagBits::Zero
+        }
+    }
+}
+
 impl From<afi::AprilTokenFlagBits> for TokenFlagBits {
-    /// Converts from the FFI representation to the Rust enum.
-    ///
-    /// # Panics
-    ///
-    /// Panics if an invalid FFI flag bit value is encountered.
+    /// Converts from the FFI representation to the Rust enum, see
+    /// [`TokenFlagBits::from_bits`].
     fn from(flag_bit: afi::AprilTokenFlagBits) -> Self {
-        match flag_bit {
-            0 => TokenFlagBits::Zero,
-            afi::AprilTokenFlagBits_APRIL_TOKEN_FLAG_WORD_BOUNDARY_BIT => {
-                TokenFlagBits::WordBoundary
-            }
-            afi::AprilTokenFlagBits_APRIL_TOKEN_FLAG_SENTENCE_END_BIT => TokenFlagBits::SentenceEnd,
-            _ => unreachable!("Unexpected AprilTokenFlagBits"),
-        }
+        TokenFlagBits::from_bits(flag_bit as u32)
     }
 }
 
@@ -366,6 +952,22 @@ impl Token {
         })
     }
 
+    /// Instantiates a token from its parts, such as one recognized by a
+    /// session in another process.
+    pub fn from_parts(
+        token: impl Into<String>,
+        logprob: f32,
+        flags: TokenFlagBits,
+        time_ms: usize,
+    ) -> Token {
+        Token {
+            token: token.into(),
+            logprob,
+            flags,
+            time_ms,
+        }
+    }
+
     /// Returns the recognition result token.
     ///
     /// The returned string contains its own formatting, which may denote the start of
@@ -406,37 +1008,117 @@ impl From<afi::AprilToken> for Token {
     }
 }
 
-/// Enumeration of April configuration flags.
-///
-/// This enum represents various configuration flags that can be used with the April library.
-#[derive(Debug, Copy, Clone, PartialEq, Default)]
-#[repr(i32)]
-pub enum ConfigFlagBits {
-    /// Represents the zero bit.
-    Zero,
+/// A token borrowed from the library, only valid for the duration of the
+/// callback it was given to. See [`ResultDelta`].
+#[repr(transparent)]
+pub struct TokenView(afi::AprilToken);
 
-    /// If set, the input audio should be fed in real-time (1 second of audio per second) in small chunks.
-    /// Calls to `aas_feed_pcm16` and `aas_flush` will be fast as it will delegate processing to a background thread.
-    /// The handler will be called from the background thread at some point later.
-    /// The accuracy may be degraded depending on the system hardware.
-    /// You may get an accuracy estimate by calling `aas_realtime_get_speedup`.
-    #[default]
-    AsyncNoRealtime,
+impl TokenView {
+    /// Returns the token's text. Borrowed unless it isn't valid UTF-8.
+    pub fn token(&self) -> std::borrow::Cow<'_, str> {
+        String::from_utf8_lossy(self.bytes())
+    }
 
-    /// Similar to `AsyncNoRealtime`, but does not degrade accuracy depending on system hardware.
-    /// However, if the system is not fast enough to process audio, the background thread will fall behind,
-    /// results may become unusable, and the handler will be called with `APRIL_RESULT_ERROR_CANT_KEEP_UP`.
-    AsyncRealtime,
-}
+    /// Returns the token's text as raw bytes.
+    pub fn bytes(&self) -> &[u8] {
+        unsafe { CStr::from_ptr(self.0.token) }.to_bytes()
+    }
 
-/// Provides a conversion from low-level FFI bindings [`afi::AprilConfigFlagBits`] to [`ConfigFlagBits`].
-///
-/// # Safety
-///
-/// The function assumes that the provided [`afi::AprilConfigFlagBits`] is a valid variant of the enum.
-/// Incorrect or invalid values may lead to undefined behavior.
-impl From<afi::AprilConfigFlagBits> for ConfigFlagBits {
-    fn from(bit: afi::AprilConfigFlagBits) -> Self {
+    /// See [`Token::logprob`].
+    pub fn logprob(&self) -> f32 {
+        self.0.logprob
+    }
+
+    /// See [`Token::flags`].
+    pub fn flags(&self) -> TokenFlagBits {
+        TokenFlagBits::from(self.0.flags)
+    }
+
+    /// Returns the library's flag bits, which unlike [`TokenView::flags`]
+    /// may combine several flags.
+    pub fn flag_bits(&self) -> u32 {
+        self.0.flags as u32
+    }
+
+    /// See [`Token::time_ms`].
+    pub fn time_ms(&self) -> usize {
+        self.0.time_ms
+    }
+
+    /// Copies the token into an owned [`Token`].
+    pub fn to_token(&self) -> Token {
+        self.0.into()
+    }
+}
+
+impl fmt::Debug for TokenView {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("TokenView")
+            .field("token", &self.token())
+            .field("logprob", &self.logprob())
+            .field("time_ms", &self.time_ms())
+            .finish()
+    }
+}
+
+/// A change to the current result, see [`Session::with_delta_handler`].
+///
+/// Apply it by removing the last `retracted` tokens, appending `appended`,
+/// and then taking the first `finalized` tokens off as a final result. The
+/// remaining tokens begin the next result.
+#[derive(Debug, Clone, Copy)]
+pub struct ResultDelta<'t> {
+    pub retracted: usize,
+    pub appended: &'t [TokenView],
+    pub finalized: usize,
+}
+
+/// What a session gives the handler of [`Session::with_delta_handler`].
+#[derive(Debug, Clone, Copy)]
+pub enum SessionEvent<'t> {
+    /// The current result changed.
+    Delta(ResultDelta<'t>),
+
+    /// See [`ResultType::CantKeepUp`].
+    CantKeepUp,
+
+    /// See [`ResultType::Silence`].
+    Silence,
+}
+
+type DeltaHandler = Box<dyn FnMut(SessionEvent<'_>) + Send>;
+
+/// Enumeration of April configuration flags.
+///
+/// This enum represents various configuration flags that can be used with the April library.
+#[derive(Debug, Copy, Clone, PartialEq, Default)]
+#[repr(i32)]
+pub enum ConfigFlagBits {
+    /// Represents the zero bit.
+    Zero,
+
+    /// If set, the input audio should be fed in real-time (1 second of audio per second) in small chunks.
+    /// Calls to `aas_feed_pcm16` and `aas_flush` will be fast as it will delegate processing to a background thread.
+    /// The handler will be called from the background thread at some point later.
+    /// The accuracy may be degraded depending on the system hardware.
+    /// You may get an accuracy estimate by calling `aas_realtime_get_speedup`.
+    #[default]
+    AsyncNoRealtime,
+
+    /// Similar to `AsyncNoRealtime`, but does not degrade accuracy depending on system hardware.
+    /// However, if the system is not fast enough to process audio, the background thread will fall behind,
+    /// results may become unusable, and the handler will be called with `APRIL_RESULT_ERROR_CANT_KEEP_UP`.
+    AsyncRealtime,
+}
+
+/// Provides a conversion from low-level FFI bindings [`afi::AprilConfigFlagBits`] to [`ConfigFlagBits`].
+///
+/// # Safety
+///
+/// The function assumes that the provided [`afi::AprilConfigFlagBits`] is a valid variant of the enum.
+/// Incorrect or invalid values may lead to undefined behavior.
+impl From<afi::AprilConfigFlagBits> for ConfigFlagBits {
+    fn from(bit: afi::AprilConfigFlagBits) -> Self {
         match bit {
             afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_ASYNC_NO_RT_BIT => {
                 ConfigFlagBits::AsyncNoRealtime
@@ -469,6 +1151,70 @@ impl From<ConfigFlagBits> for afi::AprilConfigFlagBits {
     }
 }
 
+/// Scheduling of a session's background thread. The default leaves the
+/// thread as the OS created it. Both settings are best-effort: if the OS
+/// refuses them, a warning is logged and the thread runs anyway.
+#[derive(PartialEq, Eq, Debug, Clone, Copy, Default)]
+pub struct ThreadOptions {
+    /// If not 0, pins the thread to the CPUs whose bits are set.
+    pub cpu_affinity_mask: u64,
+    /// If not 0, gives the thread realtime scheduling with this priority.
+    pub realtime_priority: i32,
+}
+
+impl From<ThreadOptions> for afi::AprilThreadOptions {
+    fn from(val: ThreadOptions) -> Self {
+        afi::AprilThreadOptions {
+            cpu_affinity_mask: val.cpu_affinity_mask,
+            realtime_priority: val.realtime_priority,
+        }
+    }
+}
+
+impl From<afi::AprilThreadOptions> for ThreadOptions {
+    fn from(val: afi::AprilThreadOptions) -> Self {
+        ThreadOptions {
+            cpu_affinity_mask: val.cpu_affinity_mask,
+            realtime_priority: val.realtime_priority,
+        }
+    }
+}
+
+/// Wake word options of a session, see [`SessionOptions::wake_word`]. The
+/// default uses the library defaults.
+#[derive(PartialEq, Debug, Clone, Copy, Default)]
+pub struct WakeOptions {
+    /// Wake network score at which the session wakes up, between 0 and 1.
+    /// 0 uses the library default of 0.5.
+    pub threshold: f32,
+    /// Milliseconds of audio kept while asleep and recognized upon waking.
+    /// 0 uses the library default of 2000.
+    pub preroll_ms: usize,
+    /// If not 0, an awake session goes back to sleep after this many
+    /// milliseconds without recognizing a token.
+    pub timeout_ms: usize,
+}
+
+impl From<WakeOptions> for afi::AprilWakeOptions {
+    fn from(val: WakeOptions) -> Self {
+        afi::AprilWakeOptions {
+            threshold: val.threshold,
+            preroll_ms: val.preroll_ms,
+            timeout_ms: val.timeout_ms,
+        }
+    }
+}
+
+impl From<afi::AprilWakeOptions> for WakeOptions {
+    fn from(val: afi::AprilWakeOptions) -> Self {
+        WakeOptions {
+            threshold: val.threshold,
+            preroll_ms: val.preroll_ms,
+            timeout_ms: val.timeout_ms,
+        }
+    }
+}
+
 /// Configuration for the April ASR system.
 ///
 /// This struct encapsulates the configuration parameters for the April ASR system,
@@ -506,8 +1252,41 @@ pub struct Config {
     handler: afi::AprilRecognitionResultHandler,
     userdata: *mut ::std::os::raw::c_void,
 
+    /// If set, recognition results are given to this as deltas instead of
+    /// to `handler`.
+    delta_handler: afi::AprilDeltaResultHandler,
+
     /// See [`ConfigFlagBits`].
     flags: ConfigFlagBits,
+
+    /// Number of hypotheses kept by beam search, or `None` for greedy search.
+    beam_size: Option<usize>,
+
+    /// Whether a voice activity detector skips audio without speech.
+    vad: bool,
+
+    /// Whether the session is lightweight, see [`SessionOptions::lightweight`].
+    lightweight: bool,
+
+    /// Wake word options, or `None` if the session is always awake.
+    wake: Option<WakeOptions>,
+
+    /// Sample rate of the fed audio, 0 if it is already at the model's.
+    input_sample_rate: usize,
+
+    /// Capacity of the audio buffer in samples, 0 for the library default.
+    audio_buffer_size: usize,
+
+    /// Buffered samples needed before a feed wakes the background thread,
+    /// 0 for one segment step of the model.
+    wake_quantum: usize,
+
+    /// Most segments run through the encoder at once, 0 for the library
+    /// default.
+    catch_up_segments: usize,
+
+    /// Scheduling of the background thread.
+    thread: ThreadOptions,
 }
 
 impl Config {
@@ -534,7 +1313,17 @@ impl Config {
             speaker,
             handler,
             userdata,
+            delta_handler: None,
             flags,
+            beam_size: None,
+            vad: false,
+            lightweight: false,
+            wake: None,
+            input_sample_rate: 0,
+            audio_buffer_size: 0,
+            wake_quantum: 0,
+            catch_up_segments: 0,
+            thread: ThreadOptions::default(),
         })
     }
 
@@ -565,6 +1354,11 @@ impl Config {
         self.userdata
     }
 
+    /// Gets the delta result handler, if results are given as deltas.
+    pub fn delta_handler(&self) -> afi::AprilDeltaResultHandler {
+        self.delta_handler
+    }
+
     /// Gets the configuration flags.
     ///
     /// # Returns
@@ -573,6 +1367,58 @@ impl Config {
     pub fn flags(&self) -> ConfigFlagBits {
         self.flags
     }
+
+    /// Gets the beam size.
+    ///
+    /// # Returns
+    ///
+    /// The number of hypotheses kept by beam search, or `None` if greedy
+    /// search is used. A size of 0 uses the library default.
+    pub fn beam_size(&self) -> Option<usize> {
+        self.beam_size
+    }
+
+    /// Gets whether voice activity detection is enabled.
+    pub fn vad(&self) -> bool {
+        self.vad
+    }
+
+    /// Gets whether the session is lightweight.
+    pub fn lightweight(&self) -> bool {
+        self.lightweight
+    }
+
+    /// Gets the wake word options, or `None` if the session is always awake.
+    pub fn wake(&self) -> Option<WakeOptions> {
+        self.wake
+    }
+
+    /// Gets the sample rate of the fed audio, 0 if it is at the model's.
+    pub fn input_sample_rate(&self) -> usize {
+        self.input_sample_rate
+    }
+
+    /// Gets the capacity of the audio buffer in samples, 0 for the library default.
+    pub fn audio_buffer_size(&self) -> usize {
+        self.audio_buffer_size
+    }
+
+    /// Gets the number of buffered samples needed before a feed wakes the
+    /// background thread, 0 for the library default.
+    pub fn wake_quantum(&self) -> usize {
+        self.wake_quantum
+    }
+
+    /// Gets the most segments run through the encoder in one call, 0 for
+    /// the library default.
+    pub fn catch_up_segments(&self) -> usize {
+        self.catch_up_segments
+    }
+
+    /// Gets the scheduling options of the background thread.
+    pub fn thread(&self) -> ThreadOptions {
+        self.thread
+    }
 }
 
 /// Conversion from low-level FFI representation (`afi::AprilConfig`) to the Rust-friendly `Config`.
@@ -600,11 +1446,31 @@ impl From<afi::AprilConfig> for Config {
         let speaker = SpeakerID::from(cfg.speaker);
         let handler = cfg.handler;
         let userdata = cfg.userdata;
-        let flags = ConfigFlagBits::from(cfg.flags);
+        let beam_bit = afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_BEAM_SEARCH_BIT;
+        let vad_bit = afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_VAD_BIT;
+        let wake_bit = afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_WAKE_BIT;
+        let lightweight_bit = afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_LIGHTWEIGHT_BIT;
+        let flags =
+            ConfigFlagBits::from(cfg.flags & !(beam_bit | vad_bit | wake_bit | lightweight_bit));
 
         // Attempt to create a new Config instance, panicking if the creation fails
-        Config::new(speaker, handler, userdata, flags)
-            .unwrap_or_else(|err| panic!("Failed to create Config: {}", err))
+        let mut config = Config::new(speaker, handler, userdata, flags)
+            .unwrap_or_else(|err| panic!("Failed to create Config: {}", err));
+        if cfg.flags & beam_bit != 0 {
+            config.beam_size = Some(cfg.beam_size);
+        }
+        config.vad = cfg.flags & vad_bit != 0;
+        config.lightweight = cfg.flags & lightweight_bit != 0;
+        if cfg.flags & wake_bit != 0 {
+            config.wake = Some(cfg.wake.into());
+        }
+        config.delta_handler = cfg.delta_handler;
+        config.input_sample_rate = cfg.input_sample_rate;
+        config.audio_buffer_size = cfg.audio_buffer_size;
+        config.wake_quantum = cfg.wake_quantum;
+        config.catch_up_segments = cfg.catch_up_segments;
+        config.thread = cfg.thread.into();
+        config
     }
 }
 
@@ -622,14 +1488,35 @@ impl From<Config> for afi::AprilConfig {
         let speaker = val.speaker.into();
         let handler = val.handler;
         let userdata = val.userdata;
-        let flags = val.flags.into();
+        let mut flags: afi::AprilConfigFlagBits = val.flags.into();
+        if val.beam_size.is_some() {
+            flags |= afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_BEAM_SEARCH_BIT;
+        }
+        if val.vad {
+            flags |= afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_VAD_BIT;
+        }
+        if val.wake.is_some() {
+            flags |= afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_WAKE_BIT;
+        }
+        if val.lightweight {
+            flags |= afi::AprilConfigFlagBits_APRIL_CONFIG_FLAG_LIGHTWEIGHT_BIT;
+        }
 
         // Create a new afi::AprilConfig instance
         afi::AprilConfig {
             speaker,
             handler,
             userdata,
+            delta_handler: val.delta_handler,
             flags,
+            batch: std::ptr::null_mut(),
+            beam_size: val.beam_size.unwrap_or(0),
+            audio_buffer_size: val.audio_buffer_size,
+            wake_quantum: val.wake_quantum,
+            catch_up_segments: val.catch_up_segments,
+            wake: val.wake.unwrap_or_default().into(),
+            input_sample_rate: val.input_sample_rate,
+            thread: val.thread.into(),
         }
     }
 }
@@ -643,7 +1530,17 @@ pub struct ConfigBuilder {
     speaker: Option<SpeakerID>,
     handler: Option<afi::AprilRecognitionResultHandler>,
     userdata: Option<*mut ::std::os::raw::c_void>,
+    delta_handler: afi::AprilDeltaResultHandler,
     flags: ConfigFlagBits,
+    beam_size: Option<usize>,
+    vad: bool,
+    lightweight: bool,
+    wake: Option<WakeOptions>,
+    input_sample_rate: usize,
+    audio_buffer_size: usize,
+    wake_quantum: usize,
+    catch_up_segments: usize,
+    thread: ThreadOptions,
 }
 
 impl ConfigBuilder {
@@ -670,24 +1567,115 @@ impl ConfigBuilder {
         self
     }
 
+    /// Gives recognition results to `delta_handler` as deltas, with the same
+    /// user-specific data. Other results still go to the handler.
+    pub fn delta_handler(&mut self, delta_handler: afi::AprilDeltaResultHandler) -> &mut Self {
+        self.delta_handler = delta_handler;
+        self
+    }
+
     /// Sets the configuration flags.
     pub fn flags(&mut self, flags: ConfigFlagBits) -> &mut Self {
         self.flags = flags;
         self
     }
 
+    /// Uses beam search keeping `beam_size` hypotheses instead of greedy
+    /// search. A size of 0 uses the library default.
+    pub fn beam_search(&mut self, beam_size: usize) -> &mut Self {
+        self.beam_size = Some(beam_size);
+        self
+    }
+
+    /// Enables the voice activity detector, which skips recognition of audio
+    /// without speech.
+    pub fn vad(&mut self, enabled: bool) -> &mut Self {
+        self.vad = enabled;
+        self
+    }
+
+    /// Makes the session lightweight, see [`SessionOptions::lightweight`].
+    pub fn lightweight(&mut self, enabled: bool) -> &mut Self {
+        self.lightweight = enabled;
+        self
+    }
+
+    /// Starts the session asleep, screening audio with the model's wake word
+    /// network until it hears the wake phrase.
+    pub fn wake_word(&mut self, options: WakeOptions) -> &mut Self {
+        self.wake = Some(options);
+        self
+    }
+
+    /// Sets the sample rate of the fed audio, which the session resamples to
+    /// the model's. 0 means the audio is already at the model's rate.
+    pub fn input_sample_rate(&mut self, rate: usize) -> &mut Self {
+        self.input_sample_rate = rate;
+        self
+    }
+
+    /// Sets the capacity of the audio buffer of asynchronous sessions, in
+    /// samples. 0 uses the library default of 3 seconds at 16 kHz.
+    pub fn audio_buffer_size(&mut self, samples: usize) -> &mut Self {
+        self.audio_buffer_size = samples;
+        self
+    }
+
+    /// Sets how many samples must be buffered before a feed wakes the
+    /// background thread. 0 uses one segment step of the model, 1 wakes it
+    /// on every feed.
+    pub fn wake_quantum(&mut self, samples: usize) -> &mut Self {
+        self.wake_quantum = samples;
+        self
+    }
+
+    /// Sets the most segments run through the encoder in one call when a
+    /// session has a backlog. Only models whose encoder has a dynamic time
+    /// axis can take more than one. 0 uses the library default, 1 disables
+    /// catching up.
+    pub fn catch_up_segments(&mut self, segments: usize) -> &mut Self {
+        self.catch_up_segments = segments;
+        self
+    }
+
+    /// Sets the scheduling of the background thread.
+    pub fn thread(&mut self, thread: ThreadOptions) -> &mut Self {
+        self.thread = thread;
+        self
+    }
+
     /// Builds the `Config` instance.
     pub fn build(&self) -> Result<Config, Box<dyn std::error::Error>> {
         let speaker = self.speaker.ok_or("Speaker ID not set")?;
         let handler = self.handler.ok_or("Recognition result handler not set")?;
         let userdata = self.userdata.ok_or("User-specific data not set")?;
+        let delta_handler = self.delta_handler;
         let flags = self.flags;
+        let beam_size = self.beam_size;
+        let vad = self.vad;
+        let lightweight = self.lightweight;
+        let wake = self.wake;
+        let input_sample_rate = self.input_sample_rate;
+        let audio_buffer_size = self.audio_buffer_size;
+        let wake_quantum = self.wake_quantum;
+        let catch_up_segments = self.catch_up_segments;
+        let thread = self.thread;
 
         Ok(Config {
             speaker,
             handler,
             userdata,
+            delta_handler,
             flags,
+            beam_size,
+            vad,
+            lightweight,
+            wake,
+            input_sample_rate,
+            audio_buffer_size,
+            wake_quantum,
+            catch_up_segments,
+            thread,
         })
     }
 }
@@ -754,6 +1742,332 @@ pub extern "C" fn handler_cb_wrapper(
     }
 }
 
+fn call_delta_handler(userdata: *mut c_void, event: SessionEvent<'_>) {
+    if let Err(e) = catch_unwind(AssertUnwindSafe(|| {
+        let handler = unsafe { (userdata as *mut DeltaHandler).as_mut() }
+            .expect("unable to get a handle to the april delta handler");
+        handler(event);
+    })) {
+        eprintln!("{:?}", e);
+        process::abort();
+    }
+}
+
+/// Passes the results a session with a delta handler still gives as a
+/// whole on to it, see [`Session::with_delta_handler`].
+pub extern "C" fn delta_events_cb_wrapper(
+    userdata: *mut c_void,
+    result_type: afi::AprilResultType,
+    _count: usize,
+    _tokens: *const afi::AprilToken,
+) {
+    match result_type {
+        afi::AprilResultType_APRIL_RESULT_ERROR_CANT_KEEP_UP => {
+            call_delta_handler(userdata, SessionEvent::CantKeepUp)
+        }
+        afi::AprilResultType_APRIL_RESULT_SILENCE => {
+            call_delta_handler(userdata, SessionEvent::Silence)
+        }
+        _ => {}
+    }
+}
+
+/// Wrapper for the C delta handler, lending the tokens to the Rust handler
+/// without copying them.
+pub extern "C" fn delta_cb_wrapper(userdata: *mut c_void, delta: *const afi::AprilResultDelta) {
+    let delta = unsafe { &*delta };
+    let appended: &[TokenView] = if delta.appended_count == 0 {
+        &[]
+    } else {
+        // TokenView is a transparent wrapper of AprilToken
+        unsafe { slice::from_raw_parts(delta.appended as *const TokenView, delta.appended_count) }
+    };
+
+    call_delta_handler(
+        userdata,
+        SessionEvent::Delta(ResultDelta {
+            retracted: delta.retracted,
+            appended,
+            finalized: delta.finalized,
+        }),
+    );
+}
+
+/// Options for creating a [`Session`] with [`Session::with_options`].
+///
+/// The defaults match [`Session::new`] with `asynchronous` and `no_rt` unset.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct SessionOptions {
+    asynchronous: bool,
+    no_rt: bool,
+    beam_size: Option<usize>,
+    vad: bool,
+    lightweight: bool,
+    wake: Option<WakeOptions>,
+    input_sample_rate: usize,
+    audio_buffer_size: usize,
+    wake_quantum: usize,
+    catch_up_segments: usize,
+    thread: ThreadOptions,
+}
+
+impl SessionOptions {
+    /// Creates options with the defaults.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Processes audio on a background thread. See [`Session::new`].
+    pub fn asynchronous(mut self, asynchronous: bool) -> Self {
+        self.asynchronous = asynchronous;
+        self
+    }
+
+    /// Disables realtime speedup of asynchronous sessions. See [`Session::new`].
+    pub fn no_realtime(mut self, no_rt: bool) -> Self {
+        self.no_rt = no_rt;
+        self
+    }
+
+    /// Decodes with beam search, keeping `beam_size` hypotheses (0 for the
+    /// library default). See [`Session::with_beam_search`].
+    pub fn beam_search(mut self, beam_size: usize) -> Self {
+        self.beam_size = Some(beam_size);
+        self
+    }
+
+    /// Skips recognition of audio without speech, finalizing results as soon
+    /// as speech stops.
+    pub fn voice_activity_detection(mut self, enabled: bool) -> Self {
+        self.vad = enabled;
+        self
+    }
+
+    /// Makes the session one of many driven by a scheduler of your own, such
+    /// as thousands of mostly idle streams. It is synchronous whatever
+    /// [`SessionOptions::asynchronous`] says, with no thread or audio buffer
+    /// of its own, and keeps less scratch memory at some cost in throughput.
+    /// See [`Session::memory_size`].
+    pub fn lightweight(mut self, enabled: bool) -> Self {
+        self.lightweight = enabled;
+        self
+    }
+
+    /// Starts the session asleep, running only the model's small wake word
+    /// network until it hears the wake phrase. The full model then recognizes
+    /// the audio from shortly before it on. Has no effect if the model has
+    /// no wake network, see [`Model::has_wake_network`].
+    pub fn wake_word(mut self, options: WakeOptions) -> Self {
+        self.wake = Some(options);
+        self
+    }
+
+    /// Sets the sample rate the audio is fed at, such as 44100 or 48000 for
+    /// most sound cards. The session resamples it to the model's sample
+    /// rate. 0 means the audio is already at [`Model::sample_rate`].
+    pub fn input_sample_rate(mut self, rate: usize) -> Self {
+        self.input_sample_rate = rate;
+        self
+    }
+
+    /// Sets the capacity of the audio buffer of asynchronous sessions, in
+    /// samples. 0 uses the library default of 3 seconds at 16 kHz.
+    pub fn audio_buffer_size(mut self, samples: usize) -> Self {
+        self.audio_buffer_size = samples;
+        self
+    }
+
+    /// Sets how many samples must be buffered before feeding an asynchronous
+    /// session wakes its thread. 0 uses one segment step of the model.
+    pub fn wake_quantum(mut self, samples: usize) -> Self {
+        self.wake_quantum = samples;
+        self
+    }
+
+    /// Sets the most segments a session which has fallen behind runs through
+    /// the encoder in one call, instead of speeding up the audio. Only models
+    /// whose encoder has a dynamic time axis can take more than one. 0 uses
+    /// the library default, 1 disables catching up.
+    pub fn catch_up_segments(mut self, segments: usize) -> Self {
+        self.catch_up_segments = segments;
+        self
+    }
+
+    /// Sets the CPU affinity and priority of an asynchronous session's thread.
+    pub fn thread(mut self, thread: ThreadOptions) -> Self {
+        self.thread = thread;
+        self
+    }
+}
+
+/// How long creating a model took, see [`Model::load_stats`]. The networks
+/// load concurrently when the model file can be mapped, so their load times
+/// overlap.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct LoadStats {
+    /// Time taken to load each network, indexed by [`Network`].
+    pub network_load_ms: [f64; NETWORK_COUNT],
+    /// Time taken to warm up each network, 0 without
+    /// [`ModelOptions::warm_up`].
+    pub network_warm_up_ms: [f64; NETWORK_COUNT],
+    /// Time taken to create the whole model.
+    pub total_ms: f64,
+}
+
+/// Statistics of a session's audio buffer, see [`Session::buffer_stats`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct BufferStats {
+    /// Capacity of the buffer in samples, 0 for synchronous sessions.
+    pub capacity: usize,
+    /// Most samples the buffer has held at once.
+    pub high_water_mark: usize,
+    /// Number of samples dropped because the buffer was full.
+    pub dropped_samples: usize,
+}
+
+/// Histogram of durations, see [`Stats`].
+///
+/// Bucket 0 counts durations under 2µs, and bucket `i` counts durations from
+/// `2^i` up to `2^(i + 1)` microseconds, with the last bucket also counting
+/// anything longer.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Histogram {
+    pub count: u64,
+    pub total_us: u64,
+    pub max_us: u64,
+    pub buckets: [u64; afi::APRIL_HISTOGRAM_BUCKETS as usize],
+}
+
+impl Histogram {
+    /// Mean duration in microseconds, or 0 if nothing was recorded.
+    pub fn mean_us(&self) -> f64 {
+        if self.count == 0 {
+            0.0
+        } else {
+            self.total_us as f64 / self.count as f64
+        }
+    }
+
+    /// Upper bound in microseconds of the bucket holding the given quantile,
+    /// e.g. `0.99` for the p99. Returns 0 if nothing was recorded.
+    pub fn quantile_us(&self, quantile: f64) -> u64 {
+        if self.count == 0 {
+            return 0;
+        }
+
+        let target = ((self.count as f64) * quantile.clamp(0.0, 1.0))
+            .ceil()
+            .max(1.0) as u64;
+        let mut seen = 0;
+        for (i, n) in self.buckets.iter().enumerate() {
+            seen += n;
+            if seen >= target {
+                return (2u64 << i).min(self.max_us);
+            }
+        }
+        self.max_us
+    }
+}
+
+impl From<afi::AprilHistogram> for Histogram {
+    fn from(histogram: afi::AprilHistogram) -> Self {
+        Histogram {
+            count: histogram.count,
+            total_us: histogram.total_us,
+            max_us: histogram.max_us,
+            buckets: histogram.buckets,
+        }
+    }
+}
+
+/// Hot-path statistics of a session or model, see [`Session::stats`] and
+/// [`Model::stats`].
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Stats {
+    /// Each call to the fbank with new audio.
+    pub fbank: Histogram,
+    /// Each encoder call. Batched sessions are each charged the full call.
+    pub encoder: Histogram,
+    /// Each decoder call, not counting outputs found in the decoder cache.
+    pub decoder: Histogram,
+    /// Each joiner call.
+    pub joiner: Histogram,
+    /// Each wake word network call while asleep.
+    pub wake: Histogram,
+    /// From when audio was fed to when a partial result including it was
+    /// given to the handler.
+    pub latency: Histogram,
+    /// Encoder frames searched.
+    pub frames: u64,
+    /// Joiner evaluations over all frames.
+    pub joiner_runs: u64,
+    /// `frames_by_joiner_runs[i]` counts frames which took `i + 1` joiner
+    /// evaluations, the last one also counting frames which took more.
+    pub frames_by_joiner_runs: [u64; afi::APRIL_STATS_JOINER_RUN_BUCKETS as usize],
+    pub decoder_cache_hits: u64,
+    pub decoder_cache_misses: u64,
+    pub buffer_capacity: usize,
+    /// Samples waiting in the audio buffer.
+    pub buffer_fill: usize,
+    pub buffer_high_water_mark: usize,
+    pub dropped_samples: u64,
+    /// Ratio of processing time to audio time. Above 1.0 the session is
+    /// falling behind.
+    pub realtime_load: f64,
+    /// 1 for a session, or the number of live sessions for a model.
+    pub session_count: usize,
+}
+
+impl From<afi::AprilStats> for Stats {
+    fn from(stats: afi::AprilStats) -> Self {
+        Stats {
+            fbank: stats.fbank.into(),
+            encoder: stats.encoder.into(),
+            decoder: stats.decoder.into(),
+            joiner: stats.joiner.into(),
+            wake: stats.wake.into(),
+            latency: stats.latency.into(),
+            frames: stats.frames,
+            joiner_runs: stats.joiner_runs,
+            frames_by_joiner_runs: stats.frames_by_joiner_runs,
+            decoder_cache_hits: stats.decoder_cache_hits,
+            decoder_cache_misses: stats.decoder_cache_misses,
+            buffer_capacity: stats.buffer_capacity,
+            buffer_fill: stats.buffer_fill,
+            buffer_high_water_mark: stats.buffer_high_water_mark,
+            dropped_samples: stats.dropped_samples,
+            realtime_load: stats.realtime_load,
+            session_count: stats.session_count,
+        }
+    }
+}
+
+/// Owns the underlying session, freeing it once the [`Session`] and any
+/// [`AudioWriter`] are gone.
+#[derive(Debug)]
+struct SessionHandle {
+    ctx: *mut afi::AprilASRSession_i,
+    writer_taken: AtomicBool,
+    // Owned by the session, null for sessions giving results to a channel
+    delta_handler: *mut DeltaHandler,
+}
+
+// The library synchronizes its own state, and the audio buffer is only
+// written by one AudioWriter at a time
+unsafe impl Send for SessionHandle {}
+unsafe impl Sync for SessionHandle {}
+
+impl Drop for SessionHandle {
+    fn drop(&mut self) {
+        unsafe {
+            afi::aas_free(self.ctx);
+            if !self.delta_handler.is_null() {
+                drop(Box::from_raw(self.delta_handler));
+            }
+        }
+    }
+}
+
 /// Wrapper for managing an April ASR session running in memory.
 ///
 /// The `Session` struct encapsulates the functionality of an ASR session and provides methods for interacting with it.
@@ -783,6 +2097,7 @@ pub extern "C" fn handler_cb_wrapper(
 #[derive(Debug)]
 pub struct Session<'a> {
     ctx: *mut afi::AprilASRSession_i,
+    handle: Arc<SessionHandle>,
     // Hold onto the model reference
     _model: &'a Model,
 }
@@ -825,17 +2140,102 @@ impl<'a> Session<'a> {
         no_rt: bool,
         // speaker_name: &str,
     ) -> Result<Session, Box<dyn std::error::Error>> {
+        let options = SessionOptions::new()
+            .asynchronous(asynchronous)
+            .no_realtime(no_rt);
+        Self::with_options(model, callback, &options)
+    }
+
+    /// Initializes a new ASR session which decodes with beam search, keeping
+    /// `beam_size` hypotheses (0 for the library default). This is more
+    /// accurate than [`Session::new`], and allows hotwords to be set with
+    /// [`Session::set_hotwords`].
+    pub fn with_beam_search(
+        model: &'a Model,
+        callback: Sender<ResultType>,
+        asynchronous: bool,
+        no_rt: bool,
+        beam_size: usize,
+    ) -> Result<Session, Box<dyn std::error::Error>> {
+        let options = SessionOptions::new()
+            .asynchronous(asynchronous)
+            .no_realtime(no_rt)
+            .beam_search(beam_size);
+        Self::with_options(model, callback, &options)
+    }
+
+    /// Initializes a new ASR session with the given [`SessionOptions`].
+    pub fn with_options(
+        model: &'a Model,
+        callback: Sender<ResultType>,
+        options: &SessionOptions,
+    ) -> Result<Session<'a>, Box<dyn std::error::Error>> {
+        let mut config_builder = Self::config_builder(options);
+        config_builder.userdata(Box::into_raw(Box::new(callback)) as *mut std::os::raw::c_void);
+        config_builder.handler(Some(handler_cb_wrapper));
+
+        Self::create(model, config_builder, std::ptr::null_mut())
+    }
+
+    /// Initializes a new ASR session which gives its results to `handler`
+    /// as [`ResultDelta`]s, instead of sending the whole current result on
+    /// every change. The tokens are lent straight from the library, so a
+    /// partial result costs nothing but the handler's own work on the new
+    /// tokens. The handler is called from the session's thread, see
+    /// [`Session::new`], and must not block it for long.
+    pub fn with_delta_handler<F>(
+        model: &'a Model,
+        options: &SessionOptions,
+        handler: F,
+    ) -> Result<Session<'a>, Box<dyn std::error::Error>>
+    where
+        F: FnMut(SessionEvent<'_>) + Send + 'static,
+    {
+        let handler: DeltaHandler = Box::new(handler);
+        let userdata = Box::into_raw(Box::new(handler));
+
+        let mut config_builder = Self::config_builder(options);
+        config_builder.userdata(userdata as *mut std::os::raw::c_void);
+        config_builder.handler(Some(delta_events_cb_wrapper));
+        config_builder.delta_handler(Some(delta_cb_wrapper));
+
+        let session = Self::create(model, config_builder, userdata);
+        if session.is_err() {
+            drop(unsafe { Box::from_raw(userdata) });
+        }
+        session
+    }
+
+    fn config_builder(options: &SessionOptions) -> ConfigBuilder {
         let mut config_builder = ConfigBuilder::new();
+        if let Some(beam_size) = options.beam_size {
+            config_builder.beam_search(beam_size);
+        }
+        config_builder.vad(options.vad);
+        config_builder.lightweight(options.lightweight);
+        if let Some(wake) = options.wake {
+            config_builder.wake_word(wake);
+        }
+        config_builder.input_sample_rate(options.input_sample_rate);
+        config_builder.audio_buffer_size(options.audio_buffer_size);
+        config_builder.wake_quantum(options.wake_quantum);
+        config_builder.catch_up_segments(options.catch_up_segments);
+        config_builder.thread(options.thread);
 
-        config_builder.flags(match (asynchronous, no_rt) {
+        config_builder.flags(match (options.asynchronous, options.no_rt) {
             (true, true) => ConfigFlagBits::AsyncNoRealtime,
             (true, false) => ConfigFlagBits::AsyncRealtime,
             _ => ConfigFlagBits::Zero,
         });
-        config_builder.userdata(Box::into_raw(Box::new(callback)) as *mut std::os::raw::c_void);
-        config_builder.handler(Some(handler_cb_wrapper));
         config_builder.speaker(SpeakerID::default()); // No speaker by default
+        config_builder
+    }
 
+    fn create(
+        model: &'a Model,
+        config_builder: ConfigBuilder,
+        delta_handler: *mut DeltaHandler,
+    ) -> Result<Session<'a>, Box<dyn std::error::Error>> {
         let config = config_builder.build().unwrap();
         let session = unsafe { afi::aas_create_session(model.ctx, config.into()) };
 
@@ -844,6 +2244,11 @@ impl<'a> Session<'a> {
         } else {
             Ok(Session {
                 ctx: session,
+                handle: Arc::new(SessionHandle {
+                    ctx: session,
+                    writer_taken: AtomicBool::new(false),
+                    delta_handler,
+                }),
                 _model: model,
             })
         }
@@ -867,79 +2272,349 @@ impl<'a> Session<'a> {
     /// attempt, the error is caught, and the session is still considered successfully freed.
     /// The error information is printed to the standard error stream.
     ///
-    /// # Safety
+    /// # Safety
+    ///
+    /// The safety of this function depends on the correctness of the `aas_free` function
+    /// from the underlying FFI (Foreign Function Interface) library. Incorrect usage or
+    /// invalid parameters may lead to undefined behavior.
+    ///
+    /// # Returns
+    ///
+    /// A `Result` containing the `Session` instance after freeing or an error message.
+    pub fn free(&self) {
+        unsafe { afi::aas_free(self.ctx) };
+    }
+
+    /// Feed PCM16 audio samples to the session.
+    ///
+    /// This method takes a vector of 8-bit PCM audio samples (`pcm16_samples`) and converts them
+    /// to 16-bit signed integers (`i16`). It ensures that every consecutive pair of bytes is
+    /// mapped to a single i16 sample using little-endian byte order.
+    ///
+    /// # Arguments
+    ///
+    /// * `pcm16_samples` - A vector of 16-bit signed integer PCM audio samples.
+    ///
+    /// # Safety
+    ///
+    /// The method internally uses unsafe code to feed the PCM16 audio data to the session.
+    /// Ensure that the provided `pcm16_bytes` vector is valid and adheres to the specified format.
+    ///
+    /// The PCM16 audio data must be single-channel and sampled according to the sample rate
+    /// obtained from `aam_get_sample_rate`.
+    pub fn feed_pcm16(&self, mut pcm16_bytes: Vec<i16>) {
+        unsafe { afi::aas_feed_pcm16(self.ctx, pcm16_bytes.as_mut_ptr(), pcm16_bytes.len()) };
+    }
+
+    /// Feeds single-channel float samples in `[-1.0, 1.0]` to the session,
+    /// at the model's sample rate or at [`SessionOptions::input_sample_rate`].
+    pub fn feed_float(&self, samples: &[f32]) {
+        unsafe { afi::aas_feed_float(self.ctx, samples.as_ptr(), samples.len()) };
+    }
+
+    /// Feeds frames of features read from a [`FeatureExtractor`] of the
+    /// same model, in place of audio. Voice activity detection is skipped.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error without feeding anything if the session is
+    /// asynchronous or batched, or if `data` isn't made of whole frames.
+    /// Also returns an error if the frames couldn't all be buffered, in
+    /// which case the rest of them are dropped.
+    pub fn feed_features(&self, data: &[u8]) -> Result<(), Box<dyn std::error::Error>> {
+        let fed =
+            unsafe { afi::aas_feed_features(self.ctx, data.as_ptr() as *const c_void, data.len()) };
+        if fed {
+            Ok(())
+        } else {
+            Err("Session can't take these features".into())
+        }
+    }
+
+    /// Gets the speedup factor for realtime processing.
+    ///
+    /// If the `ConfigFlagBits::AsyncRealtime` flag is set, this method returns a floating-point
+    /// number describing how much audio is being sped up to keep up with realtime processing.
+    /// If the number is below `1.0`, audio is not being sped up. If it is greater than `1.0`,
+    /// the audio is being sped up, and the accuracy may be reduced.
+    ///
+    /// # Safety
+    ///
+    /// This method is marked as unsafe because it relies on the correctness of the underlying
+    /// FFI (Foreign Function Interface) call to `afi::aas_realtime_get_speedup`. Incorrect usage
+    /// or invalid parameters may lead to undefined behavior.
+    ///
+    /// # Returns
+    ///
+    /// The speedup factor for realtime processing.
+    pub fn realtime_get_speedup(&self) -> f32 {
+        unsafe { afi::aas_realtime_get_speedup(self.ctx) }
+    }
+
+    /// Returns the bytes of memory the session holds on to between calls,
+    /// not counting beam search, voice activity detection and wake word state.
+    pub fn memory_size(&self) -> usize {
+        unsafe { afi::aas_get_memory_size(self.ctx) }
+    }
+
+    /// Returns statistics of the session's audio buffer.
+    pub fn buffer_stats(&self) -> BufferStats {
+        let stats = unsafe { afi::aas_get_buffer_stats(self.ctx) };
+        BufferStats {
+            capacity: stats.capacity,
+            high_water_mark: stats.high_water_mark,
+            dropped_samples: stats.dropped_samples,
+        }
+    }
+
+    /// Puts a session created with [`SessionOptions::wake_word`] to sleep,
+    /// finalizing the current result. Only the wake word network runs until
+    /// it hears the wake phrase again.
+    pub fn sleep(&self) {
+        self.wake_control().sleep()
+    }
+
+    /// Wakes the session up as if it had heard the wake phrase.
+    pub fn wake(&self) {
+        self.wake_control().wake()
+    }
+
+    /// Returns whether the session is asleep.
+    pub fn is_asleep(&self) -> bool {
+        self.wake_control().is_asleep()
+    }
+
+    /// Returns a handle which can put the session to sleep and wake it up
+    /// from another thread, such as the one receiving its results.
+    pub fn wake_control(&self) -> WakeControl<'a> {
+        WakeControl {
+            handle: self.handle.clone(),
+            _model: PhantomData,
+        }
+    }
+
+    /// Returns the session's hot-path statistics, see [`Stats`].
+    pub fn stats(&self) -> Stats {
+        unsafe { afi::aas_get_stats(self.ctx) }.into()
+    }
+
+    /// Saves the recognition state of a synchronous session into a compact
+    /// blob, from which [`Session::restore_state`] can resume it later, in this
+    /// process or another one. Voice activity detection and wake word spotter
+    /// state is not saved.
+    ///
+    /// # Returns
     ///
-    /// The safety of this function depends on the correctness of the `aas_free` function
-    /// from the underlying FFI (Foreign Function Interface) library. Incorrect usage or
-    /// invalid parameters may lead to undefined behavior.
+    /// An error if the session is asynchronous or batched.
+    pub fn save_state(&self) -> Result<Vec<u8>, Box<dyn std::error::Error>> {
+        let size = unsafe { afi::aas_save_state(self.ctx, std::ptr::null_mut(), 0) };
+        if size == 0 {
+            return Err("Only the state of synchronous sessions can be saved".into());
+        }
+
+        let mut state = vec![0u8; size];
+        let written =
+            unsafe { afi::aas_save_state(self.ctx, state.as_mut_ptr() as *mut c_void, size) };
+        debug_assert_eq!(written, size);
+        Ok(state)
+    }
+
+    /// Restores a blob from [`Session::save_state`] into a synchronous session
+    /// of a model with the same networks, which must use beam search if and
+    /// only if the saved session did. The partial result is not given to the
+    /// handler until the next token is recognized.
     ///
     /// # Returns
     ///
-    /// A `Result` containing the `Session` instance after freeing or an error message.
-    pub fn free(&self) {
-        unsafe { afi::aas_free(self.ctx) };
+    /// An error if the blob is invalid or doesn't match the session, in which
+    /// case the session is left unchanged.
+    pub fn restore_state(&self, state: &[u8]) -> Result<(), Box<dyn std::error::Error>> {
+        let ok = unsafe {
+            afi::aas_restore_state(self.ctx, state.as_ptr() as *const c_void, state.len())
+        };
+
+        if ok {
+            Ok(())
+        } else {
+            Err("The saved state doesn't match this session".into())
+        }
     }
 
-    /// Feed PCM16 audio samples to the session.
+    /// Returns a writer which feeds audio into the session's buffer, and
+    /// which can be moved to another thread such as an audio callback.
     ///
-    /// This method takes a vector of 8-bit PCM audio samples (`pcm16_samples`) and converts them
-    /// to 16-bit signed integers (`i16`). It ensures that every consecutive pair of bytes is
-    /// mapped to a single i16 sample using little-endian byte order.
+    /// Only one writer may exist at a time, and [`Session::feed_pcm16`] must not
+    /// be called while it does.
     ///
-    /// # Arguments
+    /// # Returns
     ///
-    /// * `pcm16_samples` - A vector of 16-bit signed integer PCM audio samples.
+    /// An error if a writer already exists.
+    pub fn audio_writer(&self) -> Result<AudioWriter<'a>, Box<dyn std::error::Error>> {
+        if self.handle.writer_taken.swap(true, Ordering::AcqRel) {
+            return Err("An audio writer already exists for this session".into());
+        }
+
+        Ok(AudioWriter {
+            handle: Arc::clone(&self.handle),
+            _model: PhantomData,
+        })
+    }
+
+    /// Sets phrases to favour during recognition, each with the boost added
+    /// per matched token, replacing any set before. An empty slice clears them.
     ///
-    /// # Safety
+    /// Only has an effect on sessions created with [`Session::with_beam_search`].
+    /// Phrases which can't be represented in the model's vocabulary are skipped.
     ///
-    /// The method internally uses unsafe code to feed the PCM16 audio data to the session.
-    /// Ensure that the provided `pcm16_bytes` vector is valid and adheres to the specified format.
+    /// # Returns
     ///
-    /// The PCM16 audio data must be single-channel and sampled according to the sample rate
-    /// obtained from `aam_get_sample_rate`.
-    pub fn feed_pcm16(&self, mut pcm16_bytes: Vec<i16>) {
-        unsafe { afi::aas_feed_pcm16(self.ctx, pcm16_bytes.as_mut_ptr(), pcm16_bytes.len()) };
+    /// An error if none of the given phrases could be used.
+    pub fn set_hotwords(&self, hotwords: &[(&str, f32)]) -> Result<(), Box<dyn std::error::Error>> {
+        let phrases = hotwords
+            .iter()
+            .map(|(phrase, _)| CString::new(*phrase))
+            .collect::<Result<Vec<_>, _>>()?;
+        let phrase_ptrs: Vec<*const c_char> = phrases.iter().map(|p| p.as_ptr()).collect();
+        let boosts: Vec<c_float> = hotwords.iter().map(|(_, boost)| *boost).collect();
+
+        let ok = unsafe {
+            afi::aas_set_hotwords(
+                self.ctx,
+                phrase_ptrs.as_ptr() as *mut *const c_char,
+                boosts.as_ptr(),
+                hotwords.len(),
+            )
+        };
+
+        if ok {
+            Ok(())
+        } else {
+            Err("None of the hotwords could be represented by the model".into())
+        }
     }
 
-    /// Gets the speedup factor for realtime processing.
+    /// Restricts recognition to the given phrases, one after another,
+    /// replacing any set before. An empty slice goes back to free speech.
     ///
-    /// If the `ConfigFlagBits::AsyncRealtime` flag is set, this method returns a floating-point
-    /// number describing how much audio is being sped up to keep up with realtime processing.
-    /// If the number is below `1.0`, audio is not being sped up. If it is greater than `1.0`,
-    /// the audio is being sped up, and the accuracy may be reduced.
+    /// Works with both greedy and beam search sessions. Phrases which can't
+    /// be represented in the model's vocabulary are skipped.
     ///
-    /// # Safety
+    /// # Returns
     ///
-    /// This method is marked as unsafe because it relies on the correctness of the underlying
-    /// FFI (Foreign Function Interface) call to `afi::aas_realtime_get_speedup`. Incorrect usage
-    /// or invalid parameters may lead to undefined behavior.
+    /// An error if none of the given phrases could be used, in which case the
+    /// previous phrases stay in effect.
+    pub fn set_grammar(&self, phrases: &[&str]) -> Result<(), Box<dyn std::error::Error>> {
+        let phrases = phrases
+            .iter()
+            .map(|phrase| CString::new(*phrase))
+            .collect::<Result<Vec<_>, _>>()?;
+        let phrase_ptrs: Vec<*const c_char> = phrases.iter().map(|p| p.as_ptr()).collect();
+
+        let ok = unsafe {
+            afi::aas_set_grammar(
+                self.ctx,
+                phrase_ptrs.as_ptr() as *mut *const c_char,
+                phrases.len(),
+            )
+        };
+
+        if ok {
+            Ok(())
+        } else {
+            Err("None of the phrases could be represented by the model".into())
+        }
+    }
+}
+
+/// Feeds audio into a [`Session`]'s buffer from another thread, see
+/// [`Session::audio_writer`].
+///
+/// The writer keeps the underlying session alive, so it may outlive the
+/// `Session` it came from, but not the [`Model`].
+#[derive(Debug)]
+pub struct AudioWriter<'a> {
+    handle: Arc<SessionHandle>,
+    _model: PhantomData<&'a Model>,
+}
+
+// The session's audio buffer is a single producer ring, and there is only
+// ever one writer
+unsafe impl<'a> Send for AudioWriter<'a> {}
+
+impl<'a> AudioWriter<'a> {
+    /// Lets `fill` write `count` float samples in `[-1.0, 1.0]` straight into
+    /// the session's buffer, single-channel and at the model's sample rate.
+    /// `fill` is called with consecutive parts of the samples, two if the
+    /// buffer wraps around, so audio can be converted or mixed in place.
     ///
     /// # Returns
     ///
-    /// The speedup factor for realtime processing.
-    pub fn realtime_get_speedup(&self) -> f32 {
-        unsafe { afi::aas_realtime_get_speedup(self.ctx) }
+    /// The number of samples written. If the buffer has no room for all of
+    /// them, none are written, and the session drops them and reports
+    /// [`ResultType::CantKeepUp`]. Always 0 for sessions which don't buffer
+    /// audio at the model's sample rate, such as synchronous ones or those
+    /// with [`SessionOptions::input_sample_rate`] set; use
+    /// [`AudioWriter::write_float`] for those.
+    pub fn write_in_place(&mut self, count: usize, mut fill: impl FnMut(&mut [f32])) -> usize {
+        let mut written = 0;
+        while written < count {
+            let mut region = count - written;
+            let dst = unsafe { afi::aas_feed_float_reserve(self.handle.ctx, &mut region) };
+            if dst.is_null() || region == 0 {
+                break;
+            }
+
+            fill(unsafe { slice::from_raw_parts_mut(dst, region) });
+            unsafe { afi::aas_feed_float_commit(self.handle.ctx, region) };
+            written += region;
+        }
+
+        written
+    }
+
+    /// Writes float samples in `[-1.0, 1.0]`, at the model's sample rate or
+    /// at [`SessionOptions::input_sample_rate`]. The buffer holds floats, so
+    /// they are copied in as they are, which makes this the cheapest way to
+    /// feed float audio. Samples the buffer has no room for are dropped, and
+    /// the session reports [`ResultType::CantKeepUp`].
+    pub fn write_float(&mut self, samples: &[f32]) {
+        unsafe { afi::aas_feed_float(self.handle.ctx, samples.as_ptr(), samples.len()) };
     }
 }
 
-/// Implementation of the `Drop` trait for the `Session` struct.
-///
-/// The `Drop` trait defines a method named `drop` that is called when the value
-/// goes out of scope. In this implementation, it is used to free the resources
-/// associated with the ASR session, ensuring proper cleanup.
-///
-/// # Safety
-///
-/// The `afi::aas_free` function is marked as `unsafe` because it deals with raw
-/// pointers and memory management. The implementation assumes that the
-/// `aprilasr_sys` crate provides a safe and correct way to free the resources
-/// associated with the ASR session. Incorrect usage of this function or invalid
-/// pointers may result in undefined behavior.
-impl<'a> Drop for Session<'a> {
+impl<'a> Drop for AudioWriter<'a> {
     fn drop(&mut self) {
-        unsafe {
-            afi::aas_free(self.ctx);
-        }
+        self.handle.writer_taken.store(false, Ordering::Release);
+    }
+}
+
+/// Puts a session to sleep and wakes it up from any thread, see
+/// [`Session::wake_control`]. Like [`AudioWriter`], it keeps the underlying
+/// session alive.
+#[derive(Debug, Clone)]
+pub struct WakeControl<'a> {
+    handle: Arc<SessionHandle>,
+    _model: PhantomData<&'a Model>,
+}
+
+// Requests are handed to the library atomically, from any thread
+unsafe impl<'a> Send for WakeControl<'a> {}
+unsafe impl<'a> Sync for WakeControl<'a> {}
+
+impl<'a> WakeControl<'a> {
+    /// See [`Session::sleep`].
+    pub fn sleep(&self) {
+        unsafe { afi::aas_sleep(self.handle.ctx) }
+    }
+
+    /// See [`Session::wake`].
+    pub fn wake(&self) {
+        unsafe { afi::aas_wake(self.handle.ctx) }
+    }
+
+    /// See [`Session::is_asleep`].
+    pub fn is_asleep(&self) -> bool {
+        unsafe { afi::aas_is_asleep(self.handle.ctx) }
     }
 }
 
@@ -1336,4 +3011,382 @@ mod tests {
         let _ = Session::new(&model, tx.clone(), asynchronous, no_rt).unwrap();
         let _ = Session::new(&model, tx, asynchronous, no_rt).unwrap();
     }
+
+    #[test]
+    fn test_beam_search_session_accepts_hotwords() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let session = Session::with_beam_search(&model, tx, true, true, 4).unwrap();
+
+        session
+            .set_hotwords(&[("hey computer", 2.0), ("lights off", 1.5)])
+            .unwrap();
+        session.feed_pcm16(vec![0; 3200]);
+        session.flush();
+        session.set_hotwords(&[]).unwrap();
+    }
+
+    #[test]
+    fn test_grammar_session_accepts_phrases() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let session = Session::new(&model, tx, false, false).unwrap();
+
+        session.set_grammar(&["lights on", "lights off"]).unwrap();
+        session.feed_pcm16(vec![0; 3200]);
+        session.flush();
+        session.set_grammar(&[]).unwrap();
+    }
+
+    #[test]
+    fn test_vad_session_skips_silence() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, rx) = channel();
+        let options = SessionOptions::new().voice_activity_detection(true);
+        let session = Session::with_options(&model, tx, &options).unwrap();
+
+        session.feed_pcm16(vec![0; 16000]);
+        session.flush();
+        while let Ok(result) = rx.try_recv() {
+            assert!(!is_recognition_result(result));
+        }
+    }
+
+    #[test]
+    fn test_lightweight_session_is_smaller() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let options = SessionOptions::new().asynchronous(true);
+        let regular = Session::with_options(&model, tx.clone(), &options).unwrap();
+        let lightweight = Session::with_options(&model, tx, &options.lightweight(true)).unwrap();
+
+        assert!(lightweight.memory_size() < regular.memory_size());
+
+        // Lightweight sessions ignore the asynchronous flag, so they have no
+        // audio buffer
+        assert_eq!(lightweight.buffer_stats().capacity, 0);
+        lightweight.feed_pcm16(vec![0; 16000]);
+        lightweight.flush();
+    }
+
+    #[test]
+    fn test_features_from_extractor_feed_session() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let mut extractor = FeatureExtractor::new("model.april", 0).unwrap();
+        assert_eq!(extractor.sample_rate(), model.sample_rate());
+
+        let (tx, _rx) = channel();
+        let options = SessionOptions::new().lightweight(true);
+        let session = Session::with_options(&model, tx.clone(), &options).unwrap();
+
+        extractor.feed_pcm16(&vec![0; 16000]);
+        let mut frames = vec![0u8; extractor.frame_size() * 200];
+        let len = extractor.read_frames(&mut frames);
+        assert!(len > 0);
+        assert_eq!(len % extractor.frame_size(), 0);
+
+        session.feed_features(&frames[..len]).unwrap();
+        assert!(session.feed_features(&frames[..len - 1]).is_err());
+        session.flush();
+
+        // Asynchronous sessions only take audio
+        let asynchronous =
+            Session::with_options(&model, tx, &SessionOptions::new().asynchronous(true)).unwrap();
+        assert!(asynchronous.feed_features(&frames[..len]).is_err());
+    }
+
+    #[test]
+    fn test_audio_writer_feeds_session_buffer() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let options = SessionOptions::new()
+            .asynchronous(true)
+            .no_realtime(true)
+            .audio_buffer_size(8192);
+        let session = Session::with_options(&model, tx, &options).unwrap();
+
+        let mut writer = session.audio_writer().unwrap();
+        assert!(session.audio_writer().is_err());
+
+        let written = thread::scope(|s| {
+            s.spawn(move || writer.write_in_place(1600, |dst| dst.fill(0.0)))
+                .join()
+                .unwrap()
+        });
+        assert_eq!(written, 1600);
+
+        // A synchronous session has no buffer to write into
+        let (tx, _rx) = channel();
+        let synchronous = Session::new(&model, tx, false, false).unwrap();
+        let mut writer = synchronous.audio_writer().unwrap();
+        assert_eq!(writer.write_in_place(1600, |dst| dst.fill(0.0)), 0);
+
+        let stats = session.buffer_stats();
+        assert_eq!(stats.capacity, 8192);
+        assert_eq!(stats.dropped_samples, 0);
+        assert!(session.audio_writer().is_ok());
+    }
+
+    #[test]
+    fn test_session_accepts_thread_options() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let options = SessionOptions::new()
+            .asynchronous(true)
+            .no_realtime(true)
+            .wake_quantum(1)
+            .thread(ThreadOptions {
+                cpu_affinity_mask: 1,
+                realtime_priority: 0,
+            });
+        let session = Session::with_options(&model, tx, &options).unwrap();
+
+        session.feed_pcm16(vec![0; 1600]);
+        session.flush();
+    }
+
+    #[test]
+    fn test_catch_up_session_processes_backlog() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, rx) = channel();
+        let options = SessionOptions::new()
+            .asynchronous(true)
+            .catch_up_segments(4);
+        let session = Session::with_options(&model, tx, &options).unwrap();
+
+        // A burst of audio leaves the session a backlog to catch up on
+        session.feed_pcm16(vec![0; model.sample_rate() * 2]);
+        session.flush();
+        drop(session);
+
+        assert!(rx
+            .try_iter()
+            .all(|result| !matches!(result, ResultType::CantKeepUp)));
+    }
+
+    #[test]
+    fn test_wake_word_session_sleeps_until_woken() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let options = SessionOptions::new().wake_word(WakeOptions::default());
+        let session = Session::with_options(&model, tx, &options).unwrap();
+
+        // Models without a wake network leave the session awake
+        assert_eq!(session.is_asleep(), model.has_wake_network());
+
+        let control = session.wake_control();
+        thread::scope(|s| s.spawn(|| control.wake()).join().unwrap());
+        session.feed_pcm16(vec![0; 1600]);
+        assert!(!session.is_asleep());
+
+        session.sleep();
+        session.feed_pcm16(vec![0; 1600]);
+        assert_eq!(session.is_asleep(), model.has_wake_network());
+    }
+
+    #[test]
+    fn test_transcribe_shards_long_audio() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let options = TranscribeOptions::new().threads(2).shard_length_ms(4000);
+        let audio = vec![0; model.sample_rate() * 20];
+        let transcript = model.transcribe_pcm16(&audio, &options).unwrap();
+
+        assert!(transcript.shard_count > 1);
+        assert!((transcript.audio_seconds - 20.0).abs() < 1e-6);
+        assert!(transcript
+            .tokens
+            .windows(2)
+            .all(|w| w[0].time_ms() <= w[1].time_ms()));
+    }
+
+    #[test]
+    fn test_session_state_round_trips() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let session = Session::new(&model, tx, false, false).unwrap();
+        session.feed_pcm16(vec![0; model.sample_rate() / 2]);
+
+        let state = session.save_state().unwrap();
+        let (tx, _rx) = channel();
+        let resumed = Session::new(&model, tx, false, false).unwrap();
+        resumed.restore_state(&state).unwrap();
+        assert_eq!(resumed.save_state().unwrap(), state);
+
+        assert!(resumed.restore_state(&state[..state.len() - 1]).is_err());
+
+        let (tx, _rx) = channel();
+        let beam = Session::with_beam_search(&model, tx, false, false, 4).unwrap();
+        assert!(beam.restore_state(&state).is_err());
+    }
+
+    #[test]
+    fn test_delta_handler_tracks_current_result() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, rx) = channel();
+        let mut current = 0;
+        let session = Session::with_delta_handler(
+            &model,
+            &SessionOptions::new().beam_search(4),
+            move |event| match event {
+                SessionEvent::Delta(delta) => {
+                    assert!(delta.retracted <= current);
+                    current = current - delta.retracted + delta.appended.len();
+                    assert!(delta.finalized <= current);
+                    current -= delta.finalized;
+                }
+                SessionEvent::Silence => tx.send(current).unwrap(),
+                SessionEvent::CantKeepUp => {}
+            },
+        )
+        .unwrap();
+
+        session.feed_pcm16(vec![0; model.sample_rate() * 3]);
+        session.flush();
+
+        assert_eq!(rx.try_recv(), Ok(0));
+    }
+
+    #[test]
+    fn test_session_resamples_float_input() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let native = Session::new(&model, tx, false, false).unwrap();
+        native.feed_float(&vec![0.0; model.sample_rate() * 2]);
+        native.flush();
+
+        let (tx, _rx) = channel();
+        let options = SessionOptions::new().input_sample_rate(48000);
+        let resampled = Session::with_options(&model, tx, &options).unwrap();
+        resampled.feed_float(&vec![0.0; 48000 * 2]);
+        resampled.flush();
+
+        let frames = native.stats().frames;
+        assert!(frames > 0);
+        assert!(resampled.stats().frames.abs_diff(frames) <= 1);
+    }
+
+    #[test]
+    fn test_stats_count_stages() {
+        init_april_api(APRIL_VERSION);
+
+        let model = Model::new("model.april").unwrap();
+        let (tx, _rx) = channel();
+        let session = Session::new(&model, tx, false, false).unwrap();
+
+        session.feed_pcm16(vec![0; model.sample_rate() * 2]);
+        session.flush();
+
+        let stats = session.stats();
+        assert!(stats.fbank.count > 0);
+        assert!(stats.encoder.count > 0);
+        assert!(stats.frames > 0);
+        assert!(stats.joiner_runs >= stats.frames);
+        assert_eq!(
+            stats.frames_by_joiner_runs.iter().sum::<u64>(),
+            stats.frames
+        );
+        assert_eq!(stats.session_count, 1);
+        assert!(stats.encoder.quantile_us(0.99) <= stats.encoder.max_us);
+
+        let model_stats = model.stats();
+        assert_eq!(model_stats.session_count, 1);
+        assert_eq!(model_stats.frames, stats.frames);
+
+        drop(session);
+        let model_stats = model.stats();
+        assert_eq!(model_stats.session_count, 0);
+        assert_eq!(model_stats.frames, stats.frames);
+    }
+
+    #[test]
+    fn test_models_can_share_global_thread_pool() {
+        init_april_api(APRIL_VERSION);
+
+        let options = ModelOptions::new()
+            .global_thread_pool(true)
+            .intra_op_threads(2);
+        let model_a = Model::with_options("model.april", &options).unwrap();
+        let model_b = Model::with_options("model.april", &options).unwrap();
+        assert_eq!(model_a.name(), model_b.name());
+
+        let (tx, _rx) = channel();
+        let _ = Session::new(&model_a, tx.clone(), true, true).unwrap();
+        let _ = Session::new(&model_b, tx, true, true).unwrap();
+    }
+
+    #[test]
+    fn test_model_reports_load_and_warm_up_times() {
+        init_april_api(APRIL_VERSION);
+
+        let cold = Model::new("model.april").unwrap().load_stats();
+        assert!(cold.network_load_ms[Network::Encoder as usize] > 0.0);
+        assert_eq!(cold.network_warm_up_ms, [0.0; NETWORK_COUNT]);
+
+        let options = ModelOptions::new().warm_up(true);
+        let model = Model::with_options("model.april", &options).unwrap();
+        let warm = model.load_stats();
+        assert!(warm.network_warm_up_ms[Network::Encoder as usize] > 0.0);
+        assert!(warm.total_ms >= warm.network_warm_up_ms.iter().sum::<f64>());
+
+        // A warmed up model runs like any other
+        let (tx, _rx) = channel();
+        let session = Session::new(&model, tx, false, false).unwrap();
+        session.feed_pcm16(vec![0; 16000]);
+        session.flush();
+    }
+
+    #[test]
+    fn test_model_loads_with_preferred_precision() {
+        init_april_api(APRIL_VERSION);
+
+        // Files without variants load their only networks either way
+        let options = ModelOptions::new().network_precision(NetworkPrecision::Fp32);
+        let model = Model::with_options("model.april", &options).unwrap();
+        let auto = Model::new("model.april").unwrap();
+        assert_eq!(model.name(), auto.name());
+    }
+
+    #[test]
+    fn test_model_falls_back_to_cpu_provider() {
+        init_april_api(APRIL_VERSION);
+
+        let options = ModelOptions::new()
+            .execution_providers(&[ExecutionProvider::Cuda])
+            .network_execution_providers(Network::Decoder, &[]);
+        let model = Model::with_options("model.april", &options).unwrap();
+        assert_eq!(
+            model.execution_provider(Network::Decoder),
+            ExecutionProvider::Cpu
+        );
+
+        // Whichever provider the encoder landed on must be one it was given
+        let encoder = model.execution_provider(Network::Encoder);
+        assert!(encoder == ExecutionProvider::Cuda || encoder == ExecutionProvider::Cpu);
+    }
 }
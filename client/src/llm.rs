@@ -1,6 +1,11 @@
+use anyhow::{bail, Result};
+use futures_util::StreamExt;
 use serde::{Deserialize, Serialize};
-use std::sync::mpsc::Receiver;
+use std::io::{stdout, Write};
 use std::time::Duration;
+use tokio::sync::{mpsc::UnboundedReceiver, watch};
+use tokio::task::JoinHandle;
+
 #[derive(Serialize)]
 pub struct Request {
     model: String,
@@ -13,54 +18,244 @@ pub struct Message {
     role: String,
     content: String,
 }
+
+/// One line of Ollama's streamed reply
 #[derive(Deserialize)]
 pub struct Response {
-    message: Message,
+    message: Option<Message>,
+    #[serde(default)]
+    done: bool,
+    error: Option<String>,
+}
+
+/// What the inference loop asks of the [`Client`]
+pub enum Prompt {
+    /// The infer phrase was heard, so the model can be loaded while the
+    /// prompt is spoken
+    WarmUp,
+    /// The prompt so far, on which speech has paused. It is answered in the
+    /// background, and only shown if the final prompt turns out the same
+    Partial(String),
+    /// The prompt as recognized, to be answered and shown
+    Final(String),
 }
 
 pub struct Client {
     pub model: String,
     pub endpoint: String,
-    pub receiver: Receiver<String>,
+    pub receiver: UnboundedReceiver<Prompt>,
+    pub warm_up: bool,
+    pub speculate: bool,
+}
+
+// A request on its way, and whether its prompt was confirmed as final
+struct InFlight {
+    prompt: String,
+    confirm: watch::Sender<bool>,
+    task: JoinHandle<()>,
 }
 
 impl Client {
-    pub fn handler(&self) {
-        for prompt in self.receiver.iter() {
-            log::info!("sending to ollama: {}", prompt);
-            let client = reqwest::blocking::ClientBuilder::new()
-                .timeout(Duration::from_secs(600))
-                .build()
-                .unwrap();
-            let resp = client
-                .post(&self.endpoint)
-                .json(&Request {
-                    model: self.model.clone(),
-                    messages: vec![Message {
-                        role: "user".to_string(),
-                        content: prompt.to_string(),
-                    }],
-                    stream: false,
-                })
-                .send();
-
-            let resp = match resp {
-                Ok(resp) => resp,
-                Err(e) => {
-                    log::error!("failed to send fuzzy language request to ollama: {e}");
-                    return;
+    pub async fn handler(mut self) {
+        // Keeps the connection to Ollama open between prompts. There is no
+        // overall timeout, as the reply streams in for as long as it takes
+        let http = match reqwest::Client::builder()
+            .connect_timeout(Duration::from_secs(10))
+            .tcp_nodelay(true)
+            .build()
+        {
+            Ok(http) => http,
+            Err(e) => {
+                log::error!("failed to create the ollama client: {e}");
+                return;
+            }
+        };
+
+        if self.warm_up {
+            self.load_model(&http);
+        }
+
+        let mut in_flight: Option<InFlight> = None;
+        while let Some(prompt) = self.receiver.recv().await {
+            match prompt {
+                Prompt::WarmUp => {
+                    if self.warm_up {
+                        self.load_model(&http);
+                    }
+                }
+                Prompt::Partial(prompt) => {
+                    if !self.speculate || in_flight.as_ref().is_some_and(|f| f.prompt == prompt) {
+                        continue;
+                    }
+                    if let Some(stale) = in_flight.take() {
+                        stale.task.abort();
+                    }
+                    in_flight = Some(self.ask(&http, prompt));
                 }
-            };
+                Prompt::Final(prompt) => {
+                    let flight = match in_flight.take() {
+                        Some(flight) if flight.prompt == prompt => {
+                            log::debug!("the speculative request matched the final prompt");
+                            flight
+                        }
+                        stale => {
+                            // Dropping the connection stops Ollama generating
+                            if let Some(stale) = stale {
+                                stale.task.abort();
+                            }
+                            if prompt.is_empty() {
+                                continue;
+                            }
+                            self.ask(&http, prompt)
+                        }
+                    };
+
+                    log::info!("sending to ollama: {}", flight.prompt);
+                    let _ = flight.confirm.send(true);
+                    // Replies are shown one at a time
+                    let _ = flight.task.await;
+                }
+            }
+        }
+    }
+
+    fn ask(&self, http: &reqwest::Client, prompt: String) -> InFlight {
+        let request = http.post(&self.endpoint).json(&Request {
+            model: self.model.clone(),
+            messages: vec![Message {
+                role: "user".to_string(),
+                content: prompt.clone(),
+            }],
+            stream: true,
+        });
+        let (confirm, confirmed) = watch::channel(false);
+        InFlight {
+            prompt,
+            confirm,
+            task: tokio::spawn(answer(request, confirmed)),
+        }
+    }
+
+    // A chat without messages only loads the model
+    fn load_model(&self, http: &reqwest::Client) {
+        let request = http.post(&self.endpoint).json(&Request {
+            model: self.model.clone(),
+            messages: Vec::new(),
+            stream: false,
+        });
+        tokio::spawn(async move {
+            if let Err(e) = request.send().await.and_then(|r| r.error_for_status()) {
+                log::warn!("failed to warm up the ollama model: {e}");
+            }
+        });
+    }
+}
+
+// Streams the reply into memory, showing it as it arrives once the prompt
+// is confirmed. Never shown if the prompt is dropped first
+async fn answer(request: reqwest::RequestBuilder, mut confirmed: watch::Receiver<bool>) {
+    let resp = match request.send().await.and_then(|r| r.error_for_status()) {
+        Ok(resp) => resp,
+        Err(e) => {
+            log::error!("failed to send fuzzy language request to ollama: {e}");
+            return;
+        }
+    };
 
-            let message = match resp.json() {
-                Ok(Response { message }) => message,
-                Err(e) => {
-                    log::error!("failed to parse JSON response from ollama: {e}");
+    let mut body = resp.bytes_stream();
+    let mut pending = Vec::new();
+    let mut reply = String::new();
+    let mut shown = None;
+    loop {
+        tokio::select! {
+            chunk = body.next() => match chunk {
+                Some(Ok(bytes)) => {
+                    pending.extend_from_slice(&bytes);
+                    match take_lines(&mut pending, &mut reply) {
+                        Ok(false) => {}
+                        Ok(true) => break,
+                        Err(e) => {
+                            log::error!("failed to parse JSON response from ollama: {e}");
+                            return;
+                        }
+                    }
+                }
+                Some(Err(e)) => {
+                    log::error!("lost the response from ollama: {e}");
                     return;
                 }
-            };
+                None => break,
+            },
+            // Wakes up to show what arrived before the confirmation
+            Ok(()) = confirmed.changed(), if !*confirmed.borrow() => {}
+        }
+        if *confirmed.borrow() {
+            show(&reply, &mut shown);
+        }
+    }
+
+    if confirmed.wait_for(|&confirmed| confirmed).await.is_err() {
+        return;
+    }
+    show(&reply, &mut shown);
+    println!();
+}
+
+fn show(reply: &str, shown: &mut Option<usize>) {
+    let start = shown.unwrap_or_else(|| {
+        log::info!("response from ollama:");
+        0
+    });
+    print!("{}", &reply[start..]);
+    let _ = stdout().flush();
+    *shown = Some(reply.len());
+}
+
+// Appends the content of every complete line in `pending`, returning true
+// once the reply is done
+fn take_lines(pending: &mut Vec<u8>, reply: &mut String) -> Result<bool> {
+    while let Some(end) = pending.iter().position(|&b| b == b'\n') {
+        let line: Vec<u8> = pending.drain(..=end).collect();
+        if line.iter().all(u8::is_ascii_whitespace) {
+            continue;
+        }
 
-            log::info!("response from ollama: {}", message.content);
+        let response: Response = serde_json::from_slice(&line)?;
+        if let Some(error) = response.error {
+            bail!("{error}");
+        }
+        if let Some(message) = response.message {
+            reply.push_str(&message.content);
+        }
+        if response.done {
+            return Ok(true);
         }
     }
+    Ok(false)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_streamed_lines_split_across_chunks() {
+        let mut pending = Vec::new();
+        let mut reply = String::new();
+
+        pending.extend_from_slice(b"{\"message\":{\"role\":\"assistant\",\"content\":\"Hel");
+        assert!(!take_lines(&mut pending, &mut reply).unwrap());
+        assert!(reply.is_empty());
+
+        pending.extend_from_slice(b"lo\"},\"done\":false}\n{\"message\":{\"role\":\"assistant\",");
+        assert!(!take_lines(&mut pending, &mut reply).unwrap());
+        assert_eq!(reply, "Hello");
+
+        pending.extend_from_slice(b"\"content\":\"!\"},\"done\":true}\n");
+        assert!(take_lines(&mut pending, &mut reply).unwrap());
+        assert_eq!(reply, "Hello!");
+
+        pending.extend_from_slice(b"{\"error\":\"model not found\"}\n");
+        assert!(take_lines(&mut pending, &mut reply).is_err());
+    }
 }
@@ -1,23 +1,25 @@
-use aes_gcm::{
-    aead::{Aead, OsRng},
-    AeadCore, Aes256Gcm, Key, KeyInit,
-};
 use anyhow::{anyhow, bail, Context, Result};
 use config::{Action, Mode};
 use cpal::traits::{DeviceTrait, HostTrait, StreamTrait};
 use cpal::StreamConfig;
+use daemon::DaemonConnection;
+use embedding_index::EmbeddingIndex;
+use llm::Prompt;
 use log::{error, warn};
+use matcher::{PhraseCursor, PhraseMatcher};
 use state::State;
 use std::collections::BTreeMap;
 use std::env::args;
 use std::fs::File;
-use std::io::Write;
-use std::os::unix::net::UnixStream;
+use std::path::Path;
 use std::process::Command;
-use std::sync::mpsc::{channel, Receiver};
+use std::sync::mpsc::{channel, Receiver, RecvTimeoutError, Sender};
 use std::thread;
-use tempest_client::{init_april_api, Model, ResultType, Session, Token};
-use trie_rs::Trie;
+use std::time::Duration;
+use tempest_client::{
+    init_april_api, Model, ModelOptions, Session, SessionEvent, SessionOptions, Token, WakeControl,
+    WakeOptions,
+};
 
 use candle_transformers::models::bert::{BertModel, Config, HiddenAct, DTYPE};
 
@@ -29,110 +31,99 @@ use tokenizers::{PaddingParams, Tokenizer};
 
 mod april_model;
 mod config;
+mod daemon;
+mod embedding_index;
 mod llm;
+mod matcher;
+mod remote;
 mod state;
 
-pub struct AuthenticatedUnixStream {
-    key: Key<Aes256Gcm>,
-    stream: UnixStream,
+/// A recognition delta with only its new tokens copied out, so that the
+/// audio thread doesn't rebuild the whole result on every change
+struct TranscriptDelta {
+    retracted: usize,
+    appended: Vec<Token>,
+    finalized: usize,
 }
 
-fn tokens_to_string(tokens: Vec<Token>) -> String {
-    let tokens_str: Vec<String> = tokens.iter().map(|t| t.token()).collect();
-    tokens_str.join("")
+/// A phrase heard in the current result, see [`PhraseBookkeeper::push`]
+enum Heard {
+    Mode(Mode),
+    Action(Action),
 }
 
-pub struct TrieMatchBookkeeper {
-    pub actions_consumed_upto: usize,
-    pub trie: Trie<u8>,
+/// Follows the current result with a cursor per phrase set, so that modes
+/// and actions are picked up as soon as the word after them begins
+pub struct PhraseBookkeeper {
+    pub action_matcher: PhraseMatcher,
     pub actions: BTreeMap<String, Action>,
-    pub abstract_triggers: Trie<u8>,
+    pub mode_matcher: PhraseMatcher,
     pub modes: BTreeMap<String, Mode>,
-    pub modes_consumed_upto: usize,
+    pub action_cursor: PhraseCursor,
+    pub mode_cursor: PhraseCursor,
     pub current_action: Option<Action>,
 }
 
-impl TrieMatchBookkeeper {
-    fn word_to_action(
-        &mut self,
-        phrase: &str,
-        stream: &mut Option<AuthenticatedUnixStream>,
-    ) -> bool {
-        if phrase.is_empty() {
-            return false;
-        }
-        let mut start = self.actions_consumed_upto;
-        for i in self.actions_consumed_upto + 2..phrase.len() + 1 {
-            let search = &phrase[start..i];
-            let search_results = self.trie.predictive_search(search).len();
-            log::debug!("search: {:?}, results: {}", search, search_results);
-            match search_results {
-                0 => start = i - 1,
-                1 if self.trie.exact_match(search) => {
-                    self.current_action = self.actions.get(search).cloned();
-                    self.do_action(stream);
-                    self.actions_consumed_upto = i;
-                }
-                _ => {}
+impl PhraseBookkeeper {
+    /// Returns what the token confirms was heard, each with the number of
+    /// tokens up to the end of its phrase
+    fn push(&mut self, token: &str) -> Vec<(Heard, usize)> {
+        let mut heard = Vec::new();
+        let (modes, mode_matcher) = (&self.modes, &self.mode_matcher);
+        self.mode_cursor.push(mode_matcher, token, |i, end| {
+            if let Some(mode) = modes.get(mode_matcher.phrase(i)) {
+                heard.push((Heard::Mode(*mode), end));
             }
-        }
-
-        self.actions_consumed_upto != 0
+        });
+        let (actions, action_matcher) = (&self.actions, &self.action_matcher);
+        self.action_cursor.push(action_matcher, token, |i, end| {
+            if let Some(action) = actions.get(action_matcher.phrase(i)) {
+                heard.push((Heard::Action(action.clone()), end));
+            }
+        });
+        heard
     }
-    fn word_to_trigger(&mut self, phrase: &str) -> Option<Mode> {
-        if phrase.is_empty() {
-            return None;
-        }
-        let mut start = self.modes_consumed_upto;
-        for i in self.modes_consumed_upto + 2..phrase.len() + 1 {
-            let search = &phrase[start..i];
-            let search_results = self.abstract_triggers.predictive_search(search).len();
-            log::debug!("search: {:?}, results: {}", search, search_results);
-            match search_results {
-                0 => start = i - 1,
-                1 if self.abstract_triggers.exact_match(search) => {
-                    let ret = self.modes.get(search).cloned();
-                    self.modes_consumed_upto = 0;
-                    return ret;
-                }
-                _ => {}
+
+    /// Same as [`PhraseBookkeeper::push`], for the phrases the result ends
+    /// with once it is final
+    fn finish(&mut self) -> Vec<(Heard, usize)> {
+        let mut heard = Vec::new();
+        let (modes, mode_matcher) = (&self.modes, &self.mode_matcher);
+        self.mode_cursor.finish(mode_matcher, |i, end| {
+            if let Some(mode) = modes.get(mode_matcher.phrase(i)) {
+                heard.push((Heard::Mode(*mode), end));
             }
-        }
+        });
+        let (actions, action_matcher) = (&self.actions, &self.action_matcher);
+        self.action_cursor.finish(action_matcher, |i, end| {
+            if let Some(action) = actions.get(action_matcher.phrase(i)) {
+                heard.push((Heard::Action(action.clone()), end));
+            }
+        });
+        heard
+    }
 
-        None
+    fn retract(&mut self, count: usize) {
+        self.mode_cursor.retract(count);
+        self.action_cursor.retract(count);
+    }
+
+    fn reset(&mut self) {
+        self.mode_cursor.reset();
+        self.action_cursor.reset();
     }
 
     fn clear(&mut self) {
         self.current_action = None;
-        self.actions_consumed_upto = 0;
     }
-    fn do_action(&self, stream: &mut Option<AuthenticatedUnixStream>) {
+    // Chords are queued, so that all those heard in one delta reach the
+    // daemon together, see `send_chords`
+    fn do_action(&self, chords: &mut Vec<u16>) {
         if self.current_action.is_none() {
             return;
         }
         match self.current_action.clone().unwrap() {
-            Action::Keys(keys) => {
-                let Some(stream) = stream else {
-                    warn!("keybinding will not be executed: the daemon is not running");
-                    warn!("please make sure the daemon is running as a member of the input / uinput group");
-                    return;
-                };
-                let nonce = Aes256Gcm::generate_nonce(&mut OsRng);
-                let cipher = Aes256Gcm::new(&stream.key);
-                let ciphertext = cipher.encrypt(&nonce, keys.as_bytes()).unwrap();
-                let nonce_cat_ciphertext_cat_newline =
-                    format!("{}{}\n", hex::encode(nonce), hex::encode(ciphertext));
-                if let Err(e) = stream
-                    .stream
-                    .write_all(nonce_cat_ciphertext_cat_newline.as_bytes())
-                {
-                    error!(
-                        "failed to send keyboard shortcut `{}` to daemon socket: {}",
-                        keys, e
-                    );
-                    error!("please make sure the daemon is running as a member of the input / uinput group");
-                }
-            }
+            Action::Keys(id) => chords.push(id),
             Action::Command(command) => {
                 let res = if let Some((command, args)) = command.split_first() {
                     Command::new(command).args(args).spawn()
@@ -149,80 +140,183 @@ impl TrieMatchBookkeeper {
     }
 }
 
+// Switches modes and queues actions for what was heard. `ends` is where
+// each token of the current result ends in its text
+fn act_on(
+    heard: Vec<(Heard, usize)>,
+    state: &mut State,
+    bookkeeper: &mut PhraseBookkeeper,
+    chords: &mut Vec<u16>,
+    wake: &Option<WakeControl<'static>>,
+    ends: &[usize],
+) {
+    for (heard, end) in heard {
+        match heard {
+            Heard::Mode(Mode::Wake) if !state.listening => {
+                state.listening = true;
+                state.switched_modes = true;
+            }
+            Heard::Mode(Mode::Rest) if state.listening => {
+                state.listening = false;
+                state.switched_modes = true;
+                if let Some(wake) = wake {
+                    wake.sleep();
+                }
+            }
+            Heard::Mode(Mode::Infer)
+                if !state.infer && state.listening && !state.switched_modes =>
+            {
+                // The prompt is whatever follows the phrase
+                state.infer = true;
+                state.length = end.checked_sub(1).map_or(0, |last| ends[last]);
+                state.prompt_ollama(Prompt::WarmUp);
+            }
+            Heard::Action(action) if !state.infer && state.listening && !state.switched_modes => {
+                bookkeeper.current_action = Some(action);
+                bookkeeper.do_action(chords);
+                state.already_commanded = true;
+            }
+            _ => {}
+        }
+    }
+}
+
+fn send_chords(daemon: &mut Option<DaemonConnection>, chords: &mut Vec<u16>) {
+    if chords.is_empty() {
+        return;
+    }
+    match daemon {
+        Some(daemon) => daemon.send_chords(chords),
+        None => {
+            warn!("keybinding will not be executed: the daemon is not running");
+            warn!("please make sure the daemon is running as a member of the input / uinput group");
+        }
+    }
+    chords.clear();
+}
+
 fn inference_loop(
-    mut stream: Option<AuthenticatedUnixStream>,
+    mut daemon: Option<DaemonConnection>,
     mut state: State,
-    mut bookkeeper: TrieMatchBookkeeper,
-    session_rx: Receiver<ResultType>,
+    mut bookkeeper: PhraseBookkeeper,
+    session_rx: Receiver<TranscriptDelta>,
     mut bert: BertWithCachedKeys,
+    wake: Option<WakeControl<'static>>,
 ) {
-    for result_type in session_rx {
-        match result_type {
-            ResultType::RecognitionFinal(Some(tokens)) => {
-                let sentence = tokens_to_string(tokens).to_lowercase();
-                if !state.already_commanded && state.listening {
-                    match bert.similarities(sentence.trim()) {
-                        Err(e) => {
-                            error!("failed to infer action from phrase: `{sentence}`: {e}");
-                            continue;
-                        }
-                        Ok(Some(action_str)) => {
-                            log::info!("{sentence:#?} is inferred as: {:#?}", action_str);
-                            if let Some(action) = bookkeeper.actions.get(action_str) {
-                                bookkeeper.current_action = Some(action.clone());
-                                bookkeeper.do_action(&mut stream);
-                            }
-                        }
-                        _ => {}
+    // The current result, lowercased, and where each of its tokens ends
+    let mut text = String::new();
+    let mut ends: Vec<usize> = Vec::new();
+    let mut chords = Vec::new();
+    let mut speculated = false;
+    loop {
+        let delta = match session_rx.recv_timeout(PROMPT_PAUSE) {
+            Ok(delta) => delta,
+            Err(RecvTimeoutError::Timeout) => {
+                // Speech paused on the prompt, which is then likely final,
+                // so the reply can get going before the result is
+                if state.infer && !speculated {
+                    let prompt = text.get(state.length..).unwrap_or_default().trim();
+                    if !prompt.is_empty() {
+                        state.prompt_ollama(Prompt::Partial(prompt.to_string()));
                     }
+                    speculated = true;
                 }
+                continue;
+            }
+            Err(RecvTimeoutError::Disconnected) => return,
+        };
+        speculated = false;
+
+        ends.truncate(ends.len() - delta.retracted);
+        text.truncate(ends.last().copied().unwrap_or(0));
+        bookkeeper.retract(delta.retracted);
+
+        for token in &delta.appended {
+            let token = token.token().to_lowercase();
+            text.push_str(&token);
+            ends.push(text.len());
+
+            let heard = bookkeeper.push(&token);
+            act_on(
+                heard,
+                &mut state,
+                &mut bookkeeper,
+                &mut chords,
+                &wake,
+                &ends,
+            );
+        }
+        // Nothing follows a result which is final throughout, so the phrase
+        // it ends with is heard now
+        if delta.finalized > 0 && delta.finalized == ends.len() {
+            let heard = bookkeeper.finish();
+            act_on(
+                heard,
+                &mut state,
+                &mut bookkeeper,
+                &mut chords,
+                &wake,
+                &ends,
+            );
+        }
+        send_chords(&mut daemon, &mut chords);
+
+        if delta.finalized == 0 {
+            // a bunch of indicators for sanity check
+            let mode = if state.infer { "infer" } else { "eager" };
+            let listening_indicator = if state.listening { "" } else { "not " };
+            log::info!("[{}] [{}listening] {}", mode, listening_indicator, text);
+            continue;
+        }
 
-                if state.infer {
-                    if let Some(prompt) = sentence.get(state.length..) {
-                        state
-                            .to_ollama
-                            .clone()
-                            .expect("could not get a handle to prompt sender channel")
-                            .send(prompt.to_string())
-                            .expect("failed to send proompt");
-                    }
-                }
-                state.clear();
-                bookkeeper.clear();
+        let cut = ends[delta.finalized - 1];
+        let sentence: String = text.drain(..cut).collect();
+        ends.drain(..delta.finalized);
+        for end in ends.iter_mut() {
+            *end -= cut;
+        }
+
+        // The tokens left over begin the next result. They were already
+        // matched, so their phrases are not acted on a second time
+        bookkeeper.reset();
+        let mut start = 0;
+        for &end in &ends {
+            bookkeeper.push(&text[start..end]);
+            start = end;
+        }
+
+        // Woken up by something other than the wake phrase, so the
+        // full model can go back to sleep
+        if !state.listening {
+            if let Some(wake) = &wake {
+                wake.sleep();
             }
-            ResultType::RecognitionPartial(Some(tokens)) => {
-                let sentence = tokens_to_string(tokens).to_lowercase();
-                if sentence.len() < state.length {
+        }
+        if !state.already_commanded && state.listening {
+            match bert.similarities(sentence.trim()) {
+                Err(e) => {
+                    error!("failed to infer action from phrase: `{sentence}`: {e}");
                     continue;
                 }
-                // a bunch of indicators for sanity check
-                let mode = if state.infer { "infer" } else { "eager" };
-                let listening_indicator = if state.listening { "" } else { "not " };
-                log::info!("[{}] [{}listening] {}", mode, listening_indicator, sentence,);
-
-                if !state.listening && bookkeeper.word_to_trigger(&sentence) == Some(Mode::Wake) {
-                    state.listening = true;
-                    state.switched_modes = true;
-                } else if state.listening
-                    && bookkeeper.word_to_trigger(&sentence) == Some(Mode::Rest)
-                {
-                    state.listening = false;
-                    state.switched_modes = true;
-                }
-                if !state.infer && state.listening && !state.switched_modes {
-                    if bookkeeper.word_to_trigger(&sentence) == Some(Mode::Infer) {
-                        state.infer = true;
-                        continue;
-                    }
-
-                    if bookkeeper.word_to_action(&sentence, &mut stream) {
-                        state.already_commanded = true;
+                Ok(Some(action_str)) => {
+                    log::info!("{sentence:#?} is inferred as: {:#?}", action_str);
+                    if let Some(action) = bookkeeper.actions.get(action_str) {
+                        bookkeeper.current_action = Some(action.clone());
+                        bookkeeper.do_action(&mut chords);
+                        send_chords(&mut daemon, &mut chords);
                     }
-                    state.length = sentence.len();
                 }
+                _ => {}
             }
-            _ => {}
         }
+
+        if state.infer {
+            // An empty prompt drops any speculative request
+            let prompt = sentence.get(state.length..).unwrap_or_default().trim();
+            state.prompt_ollama(Prompt::Final(prompt.to_string()));
+        }
+        state.clear();
+        bookkeeper.clear();
     }
 }
 
@@ -230,33 +324,8 @@ fn inference_loop(
 async fn main() -> Result<()> {
     simple_logger::init_with_level(log::Level::Info)?;
 
-    let Some(audio_device) = cpal::default_host().default_input_device() else {
-        bail!("no audio input device available");
-    };
-
     init_april_api(1); // Initialize April ASR. Required to load a Model.
 
-    let socket = match (
-        UnixStream::connect("/run/tempest.socket"),
-        args().into_iter().skip(1).next(),
-    ) {
-        (Ok(stream), Some(key)) => {
-            let key_bytes = hex::decode(key.as_bytes())?;
-            let key = Key::<Aes256Gcm>::from_slice(&key_bytes).clone();
-
-            Some(AuthenticatedUnixStream { stream, key })
-        }
-        (Err(e), Some(_)) => {
-            error!("failed to connect to the daemon socket: {e}");
-            warn!("bindings to keyboard shortcuts require connection to the daemon, they will not work for this session.");
-            None
-        }
-        _ => {
-            warn!("token supplied to connect to the daemon is either nonexistent or incorrect");
-            None
-        }
-    };
-
     let data_home = xdg::BaseDirectories::with_prefix("tempest")?.get_data_home();
     if !data_home.exists() {
         std::fs::create_dir(&data_home)?;
@@ -269,6 +338,21 @@ async fn main() -> Result<()> {
     if !model_path.exists() {
         april_model::download(&model_path).await?;
     }
+    let model_path = model_path.to_string_lossy().to_string();
+
+    // `tempest-client serve [address]` recognizes speech for edges which
+    // only compute features, see `recognition_server` in config.yml
+    if args().nth(1).as_deref() == Some("serve") {
+        let addr = args()
+            .nth(2)
+            .unwrap_or_else(|| DEFAULT_SERVER_ADDR.to_string());
+        let model = load_model(&model_path, &data_home)?;
+        return remote::serve(model, &model_path, &addr);
+    }
+
+    let Some(audio_device) = cpal::default_host().default_input_device() else {
+        bail!("no audio input device available");
+    };
 
     let conf: config::RawConfig = {
         let reader = File::open("config.yml")?;
@@ -276,37 +360,106 @@ async fn main() -> Result<()> {
     };
 
     let conf: config::Config = conf.into();
-    let bert = BertWithCachedKeys::with_keys(conf.keys)?;
 
-    let mut state = State::default();
+    // Authenticated once, the connection is kept for the whole session
+    let daemon = match args().nth(1) {
+        Some(token) => {
+            match DaemonConnection::connect(daemon::SOCKET_PATH, &token, conf.key_phrases) {
+                Ok(daemon) => Some(daemon),
+                Err(e) => {
+                    error!("failed to connect to the daemon socket: {e}");
+                    warn!("bindings to keyboard shortcuts require connection to the daemon, they will not work for this session.");
+                    None
+                }
+            }
+        }
+        None => {
+            warn!("token supplied to connect to the daemon is either nonexistent or incorrect");
+            None
+        }
+    };
+    let bert = BertWithCachedKeys::with_keys(conf.keys, &data_home.join("embedding-index"))?;
 
-    let model_path = model_path.to_string_lossy().to_string();
-    let model =
-        Model::new(&model_path).map_err(|e| anyhow!("failed to load april-asr model: {e}"))?;
+    let mut state = State::default();
 
     {
-        let (tx, rx) = channel();
+        let (tx, rx) = tokio::sync::mpsc::unbounded_channel();
         state.ollama_channel(tx);
         let ollama = llm::Client {
             model: conf.ollama_model,
             endpoint: conf.ollama_endpoint,
             receiver: rx,
+            warm_up: conf.ollama_warm_up,
+            speculate: conf.ollama_speculate,
         };
-        std::thread::spawn(move || ollama.handler());
+        tokio::spawn(ollama.handler());
     }
 
-    let (tx, rx) = channel();
-    // create an audio stream
+    let (session_tx, session_rx) = channel();
+
+    // Audio is captured at the device's own rate, the session resamples it
+    let input_rate = audio_device
+        .default_input_config()
+        .context("failed to query the audio input configuration")?
+        .sample_rate();
+
+    // Favour the configured phrases, so that commands are recognized reliably
+    let hotwords: Vec<String> = conf
+        .modes
+        .keys()
+        .chain(conf.actions.keys())
+        .cloned()
+        .collect();
+
+    let (wake, mut feed): (Option<WakeControl<'static>>, Box<dyn FnMut(&[f32]) + Send>) =
+        match &conf.recognition_server {
+            Some(server) => {
+                // The server's session has no wake word network or voice
+                // activity detection to lean on, as it only gets features
+                let mut features = remote::FeatureStream::connect(
+                    server,
+                    &model_path,
+                    input_rate.0 as usize,
+                    hotwords,
+                    session_tx,
+                )?;
+                log::info!("streaming features to the recognition server at {server}");
+                (None, Box::new(move |data| features.feed(data)))
+            }
+            None => {
+                let model = load_model(&model_path, &data_home)?;
+                let session = local_session(model, input_rate.0 as usize, &hotwords, session_tx)?;
+
+                // Samples are fed from the audio callback into the session's
+                // buffer, resampled on the way if need be. The writer keeps
+                // the session alive
+                let mut writer = session
+                    .audio_writer()
+                    .map_err(|e| anyhow!("failed to create april-asr audio writer: {e}"))?;
+                let wake = model.has_wake_network().then(|| session.wake_control());
+                (wake, Box::new(move |data| writer.write_float(data)))
+            }
+        };
+
+    let bookkeeper = PhraseBookkeeper {
+        action_matcher: conf.action_matcher,
+        actions: conf.actions,
+        mode_matcher: conf.mode_matcher,
+        modes: conf.modes,
+        action_cursor: PhraseCursor::new(),
+        mode_cursor: PhraseCursor::new(),
+        current_action: None,
+    };
+
+    thread::spawn(move || inference_loop(daemon, state, bookkeeper, session_rx, bert, wake));
+
     let maybe_stream = audio_device.build_input_stream(
         &StreamConfig {
             channels: 1,
-            sample_rate: cpal::SampleRate(16000),
+            sample_rate: input_rate,
             buffer_size: cpal::BufferSize::Default,
         },
-        move |data: &[i16], _: &cpal::InputCallbackInfo| {
-            tx.send(data.to_vec())
-                .expect("unable to send audio to model");
-        },
+        move |data: &[f32], _: &cpal::InputCallbackInfo| feed(data),
         move |err| {
             log::error!("{err}");
         },
@@ -315,29 +468,81 @@ async fn main() -> Result<()> {
 
     let stream = maybe_stream.context("failed to build audio input stream")?;
 
-    let (session_tx, session_rx) = channel();
+    stream.play()?;
 
-    let session = Session::new(&model, session_tx, true, true)
-        .map_err(|e| anyhow!("failed to create april-asr speech recognition session: {e}"))?;
+    // Audio is fed from the stream's callback, this thread only keeps the
+    // stream and session alive
+    loop {
+        thread::park();
+    }
+}
 
-    let bookkeeper = TrieMatchBookkeeper {
-        actions_consumed_upto: 0,
-        modes_consumed_upto: 0,
-        trie: conf.word_trie,
-        abstract_triggers: conf.abstract_triggers,
-        modes: conf.modes,
-        actions: conf.actions,
-        current_action: None,
-    };
+const DEFAULT_SERVER_ADDR: &str = "0.0.0.0:7393";
 
-    thread::spawn(move || inference_loop(socket, state, bookkeeper, session_rx, bert));
+// How long speech must pause on a partial prompt before it is sent to
+// Ollama speculatively
+const PROMPT_PAUSE: Duration = Duration::from_millis(300);
 
-    stream.play()?;
+// The model lives as long as the process, so the audio callback can own a
+// writer into the session, and the server's threads can share it
+fn load_model(model_path: &str, data_home: &Path) -> Result<&'static Model> {
+    let cache_dir = data_home.join("ort-cache");
+    if !cache_dir.exists() {
+        std::fs::create_dir(&cache_dir)?;
+    }
+    let model_options = ModelOptions::new()
+        .global_thread_pool(true)
+        .optimized_model_cache_dir(&cache_dir.to_string_lossy())
+        .warm_up(true);
+    Ok(Box::leak(Box::new(
+        Model::with_options(model_path, &model_options)
+            .map_err(|e| anyhow!("failed to load april-asr model: {e}"))?,
+    )))
+}
 
-    for bytes in rx {
-        session.feed_pcm16(bytes);
+fn local_session(
+    model: &'static Model,
+    input_rate: usize,
+    hotwords: &[String],
+    session_tx: Sender<TranscriptDelta>,
+) -> Result<Session<'static>> {
+    let mut session_options = SessionOptions::new()
+        .asynchronous(true)
+        .no_realtime(true)
+        .beam_search(4)
+        .voice_activity_detection(true)
+        .input_sample_rate(input_rate);
+    // While not listening, only the wake word network screens the audio.
+    // The wake phrase is recognized again by the full model from the
+    // pre-roll, which is what switches to listening
+    if model.has_wake_network() {
+        session_options = session_options.wake_word(WakeOptions {
+            timeout_ms: 8000,
+            ..WakeOptions::default()
+        });
+    } else {
+        log::info!("the model has no wake word network, the full model will run on all audio");
+    }
+    let session = Session::with_delta_handler(model, &session_options, move |event| {
+        if let SessionEvent::Delta(delta) = event {
+            // The receiver only goes away when the process exits
+            let _ = session_tx.send(TranscriptDelta {
+                retracted: delta.retracted,
+                appended: delta.appended.iter().map(|t| t.to_token()).collect(),
+                finalized: delta.finalized,
+            });
+        }
+    })
+    .map_err(|e| anyhow!("failed to create april-asr speech recognition session: {e}"))?;
+
+    let hotwords: Vec<(&str, f32)> = hotwords
+        .iter()
+        .map(|phrase| (phrase.as_str(), 2.0))
+        .collect();
+    if let Err(e) = session.set_hotwords(&hotwords) {
+        log::warn!("unable to set hotwords: {e}");
     }
-    Ok(())
+    Ok(session)
 }
 
 pub struct Bert {
@@ -348,37 +553,31 @@ pub struct Bert {
 pub struct BertWithCachedKeys {
     bert: Bert,
     keys: Vec<String>,
-    embeddings: Tensor,
+    index: EmbeddingIndex,
 }
 
 impl BertWithCachedKeys {
-    fn with_keys(keys: Vec<String>) -> Result<Self> {
+    fn with_keys(keys: Vec<String>, index_dir: &Path) -> Result<Self> {
         let mut bert = Bert::new()?;
-        let embeddings = bert.cache_embeddings(keys.iter().map(|s| s.as_str()).collect())?;
-        Ok(Self {
-            bert,
-            keys,
-            embeddings,
-        })
+        let device = bert.device.clone();
+        let index = EmbeddingIndex::load_or_build(
+            index_dir,
+            BERT_MODEL_ID,
+            BERT_REVISION,
+            &keys,
+            &device,
+            || bert.cache_embeddings(keys.iter().map(|s| s.as_str()).collect()),
+        )?;
+        Ok(Self { bert, keys, index })
     }
 
     fn similarities(&mut self, sentence: &str) -> Result<Option<&str>> {
+        // Embeddings are L2 normalized, so their dot product is the cosine
+        // similarity
         let target = self.bert.cache_embeddings(vec![sentence])?.get(0)?;
 
-        let mut similarities = vec![];
-        for i in 0..self.keys.len() {
-            let e_i = self.embeddings.get(i)?;
-            let sum_ij = (&e_i * &target)?.sum_all()?.to_scalar::<f32>()?;
-            let sum_i2 = (&e_i * &e_i)?.sum_all()?.to_scalar::<f32>()?;
-            let sum_j2 = (&target * &target)?.sum_all()?.to_scalar::<f32>()?;
-            let cosine_similarity = sum_ij / (sum_i2 * sum_j2).sqrt();
-            similarities.push((cosine_similarity, i))
-        }
-
-        if let Some((similarity, index)) =
-            similarities.into_iter().max_by(|u, v| u.0.total_cmp(&v.0))
-        {
-            println!("similarity: {similarity}");
+        if let Some((index, similarity)) = self.index.best_match(&target)? {
+            log::debug!("similarity: {similarity}");
             if similarity > 0.33 {
                 return Ok(Some(self.keys[index].as_str()));
             }
@@ -387,12 +586,17 @@ impl BertWithCachedKeys {
     }
 }
 
+const BERT_MODEL_ID: &str = "sentence-transformers/all-MiniLM-L6-v2";
+const BERT_REVISION: &str = "refs/pr/21";
+
 impl Bert {
     fn new() -> Result<Bert> {
         let device = candle_core::Device::Cpu;
-        let model_id = "sentence-transformers/all-MiniLM-L6-v2".to_string();
-        let revision = "refs/pr/21".to_string();
-        let repo = Repo::with_revision(model_id, RepoType::Model, revision);
+        let repo = Repo::with_revision(
+            BERT_MODEL_ID.to_string(),
+            RepoType::Model,
+            BERT_REVISION.to_string(),
+        );
         let (config_filename, tokenizer_filename, weights_filename) = {
             let api = Api::new()?;
             let api = api.repo(repo);
@@ -443,14 +647,14 @@ impl Bert {
 
         let token_ids = Tensor::stack(&token_ids, 0)?;
         let token_type_ids = token_ids.zeros_like()?;
-        println!("running inference on batch {:?}", token_ids.shape());
+        log::debug!("running inference on batch {:?}", token_ids.shape());
         let embeddings = self.model.forward(&token_ids, &token_type_ids)?;
-        println!("generated embeddings {:?}", embeddings);
+        log::debug!("generated embeddings {:?}", embeddings.shape());
         // Apply some avg-pooling by taking the mean embedding value for all tokens (including padding)
         let (_n_sentence, n_tokens, _hidden_size) = embeddings.dims3()?;
         let embeddings = (embeddings.sum(1)? / (n_tokens as f64))?;
         let embeddings = normalize_l2(&embeddings)?;
-        println!("pooled embeddings {:?}", embeddings.shape());
+        log::debug!("pooled embeddings {:?}", embeddings.shape());
         Ok(embeddings)
     }
 }
@@ -0,0 +1,366 @@
+const ROOT: u32 = 0;
+
+struct Node {
+    // Sorted by byte
+    edges: Vec<(u8, u32)>,
+    fail: u32,
+    // Phrase ending at this node, if any
+    phrase: Option<usize>,
+    // Nearest node down the fail chain which ends a phrase, ROOT if none
+    output: u32,
+    // Bytes from the root
+    depth: u32,
+}
+
+// Phrases must end where a word does, so "pen" doesn't match in "pencil"
+fn is_word_boundary(byte: u8) -> bool {
+    !(byte.is_ascii_alphanumeric() || byte == b'\'' || byte >= 0x80)
+}
+
+/// Aho-Corasick automaton over a set of phrases, matching them as whole
+/// words anywhere in a stream of recognized tokens. See [`PhraseCursor`].
+pub struct PhraseMatcher {
+    nodes: Vec<Node>,
+    phrases: Vec<String>,
+}
+
+impl PhraseMatcher {
+    pub fn new<I, S>(phrases: I) -> Self
+    where
+        I: IntoIterator<Item = S>,
+        S: AsRef<str>,
+    {
+        let mut matcher = PhraseMatcher {
+            nodes: vec![Node {
+                edges: Vec::new(),
+                fail: ROOT,
+                phrase: None,
+                output: ROOT,
+                depth: 0,
+            }],
+            phrases: Vec::new(),
+        };
+
+        for phrase in phrases {
+            let phrase = phrase.as_ref().trim().to_lowercase();
+            if phrase.is_empty() || matcher.phrases.contains(&phrase) {
+                continue;
+            }
+
+            // Words start with a space in the token stream, so the leading
+            // space anchors the phrase to the start of a word
+            let mut state = ROOT;
+            for byte in std::iter::once(b' ').chain(phrase.bytes()) {
+                state = matcher.child_or_insert(state, byte);
+            }
+            matcher.nodes[state as usize].phrase = Some(matcher.phrases.len());
+            matcher.phrases.push(phrase);
+        }
+
+        matcher.link();
+        matcher
+    }
+
+    fn child(&self, state: u32, byte: u8) -> Option<u32> {
+        let edges = &self.nodes[state as usize].edges;
+        edges
+            .binary_search_by_key(&byte, |edge| edge.0)
+            .ok()
+            .map(|i| edges[i].1)
+    }
+
+    fn child_or_insert(&mut self, state: u32, byte: u8) -> u32 {
+        let next = self.nodes.len() as u32;
+        let depth = self.nodes[state as usize].depth + 1;
+        let edges = &mut self.nodes[state as usize].edges;
+        match edges.binary_search_by_key(&byte, |edge| edge.0) {
+            Ok(i) => edges[i].1,
+            Err(i) => {
+                edges.insert(i, (byte, next));
+                self.nodes.push(Node {
+                    edges: Vec::new(),
+                    fail: ROOT,
+                    phrase: None,
+                    output: ROOT,
+                    depth,
+                });
+                next
+            }
+        }
+    }
+
+    // Sets the fail and output links breadth first, so that every node's
+    // links are set before its children's
+    fn link(&mut self) {
+        let mut queue = std::collections::VecDeque::from([ROOT]);
+        while let Some(state) = queue.pop_front() {
+            for i in 0..self.nodes[state as usize].edges.len() {
+                let (byte, child) = self.nodes[state as usize].edges[i];
+                let fail = if state == ROOT {
+                    ROOT
+                } else {
+                    self.step(self.nodes[state as usize].fail, byte)
+                };
+
+                let output = if self.nodes[fail as usize].phrase.is_some() {
+                    fail
+                } else {
+                    self.nodes[fail as usize].output
+                };
+                self.nodes[child as usize].fail = fail;
+                self.nodes[child as usize].output = output;
+                queue.push_back(child);
+            }
+        }
+    }
+
+    fn step(&self, mut state: u32, byte: u8) -> u32 {
+        loop {
+            if let Some(next) = self.child(state, byte) {
+                return next;
+            }
+            if state == ROOT {
+                return ROOT;
+            }
+            state = self.nodes[state as usize].fail;
+        }
+    }
+
+    // The longest phrase ending at `state`, and whether it is the whole path
+    // to `state` rather than a suffix of it
+    fn longest_match(&self, state: u32) -> Option<(usize, bool)> {
+        let node = &self.nodes[state as usize];
+        match node.phrase {
+            Some(phrase) => Some((phrase, true)),
+            None if node.output != ROOT => self.nodes[node.output as usize]
+                .phrase
+                .map(|phrase| (phrase, false)),
+            None => None,
+        }
+    }
+
+    /// The phrase with the given index, as passed to [`PhraseCursor::push`]'s
+    /// callback. Phrases are lowercased and trimmed.
+    pub fn phrase(&self, index: usize) -> &str {
+        &self.phrases[index]
+    }
+}
+
+/// Position of a [`PhraseMatcher`] in the current recognition result, which
+/// follows it token by token as it grows and is corrected.
+///
+/// The state after every token is kept, so retracting tokens costs nothing.
+/// A phrase is reported once the word after it begins, or the result is
+/// finished, and only once even if its tokens are retracted and given again.
+/// Where phrases overlap only the longest is reported, and a phrase which a
+/// longer one may still extend, such as "open" in "open browser", is held
+/// back until the words after it tell them apart.
+pub struct PhraseCursor {
+    // positions[i] is the position after i tokens
+    positions: Vec<Position>,
+    // (tokens up to its end, phrase) of every report in this result
+    reported: Vec<(usize, usize)>,
+}
+
+#[derive(Clone, Copy)]
+struct Position {
+    state: u32,
+    // (tokens up to its end, phrase) of a match held back while the path
+    // to `state` may still become a longer phrase
+    held: Option<(usize, usize)>,
+}
+
+impl Default for PhraseCursor {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl PhraseCursor {
+    pub fn new() -> Self {
+        PhraseCursor {
+            positions: vec![Position {
+                state: ROOT,
+                held: None,
+            }],
+            reported: Vec::new(),
+        }
+    }
+
+    /// Number of tokens the cursor has consumed.
+    pub fn len(&self) -> usize {
+        self.positions.len() - 1
+    }
+
+    /// Feeds the next token of the result, calling `on_match` with the index
+    /// of every phrase it confirms and the number of tokens up to the
+    /// phrase's end.
+    pub fn push(
+        &mut self,
+        matcher: &PhraseMatcher,
+        token: &str,
+        mut on_match: impl FnMut(usize, usize),
+    ) {
+        let Position {
+            mut state,
+            mut held,
+        } = *self.positions.last().unwrap();
+        let consumed = self.len();
+        for (i, byte) in token.bytes().enumerate() {
+            let byte = byte.to_ascii_lowercase();
+            if is_word_boundary(byte) {
+                let end = if i == 0 { consumed } else { consumed + 1 };
+                match matcher.longest_match(state) {
+                    // A shorter phrase inside the one held back
+                    Some((_, false)) if held.is_some() => {}
+                    Some((phrase, _)) if matcher.child(state, byte).is_some() => {
+                        held = Some((end, phrase));
+                    }
+                    Some((phrase, _)) => {
+                        held = None;
+                        self.report(end, phrase, &mut on_match);
+                    }
+                    None => {}
+                }
+            }
+
+            // Anything but following an edge leaves the held phrase's path
+            let next = matcher.step(state, byte);
+            if matcher.nodes[next as usize].depth != matcher.nodes[state as usize].depth + 1 {
+                if let Some((end, phrase)) = held.take() {
+                    self.report(end, phrase, &mut on_match);
+                }
+            }
+            state = next;
+        }
+
+        self.positions.push(Position { state, held });
+    }
+
+    /// Ends the result, calling `on_match` as [`PhraseCursor::push`] does for
+    /// the phrase it ends with or, failing that, the one held back.
+    pub fn finish(&mut self, matcher: &PhraseMatcher, mut on_match: impl FnMut(usize, usize)) {
+        let Position { state, held } = *self.positions.last().unwrap();
+        let end = self.len();
+        match (matcher.longest_match(state), held) {
+            (Some((phrase, true)), _) | (Some((phrase, false)), None) => {
+                self.report(end, phrase, &mut on_match)
+            }
+            (_, Some((end, phrase))) => self.report(end, phrase, &mut on_match),
+            (None, None) => {}
+        }
+    }
+
+    fn report(&mut self, end: usize, phrase: usize, on_match: &mut impl FnMut(usize, usize)) {
+        if !self.reported.contains(&(end, phrase)) {
+            self.reported.push((end, phrase));
+            on_match(phrase, end);
+        }
+    }
+
+    /// Forgets the last `count` tokens, as they were retracted.
+    pub fn retract(&mut self, count: usize) {
+        self.positions.truncate(self.positions.len() - count);
+    }
+
+    /// Starts a new result.
+    pub fn reset(&mut self) {
+        self.positions.truncate(1);
+        self.reported.clear();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn matches(matcher: &PhraseMatcher, cursor: &mut PhraseCursor, token: &str) -> Vec<String> {
+        let mut found = Vec::new();
+        cursor.push(matcher, token, |i, _| {
+            found.push(matcher.phrase(i).to_string())
+        });
+        found
+    }
+
+    fn finish(matcher: &PhraseMatcher, cursor: &mut PhraseCursor) -> Vec<String> {
+        let mut found = Vec::new();
+        cursor.finish(matcher, |i, _| found.push(matcher.phrase(i).to_string()));
+        found
+    }
+
+    #[test]
+    fn test_phrase_fires_at_end_of_word() {
+        let matcher = PhraseMatcher::new(["open browser", "browser", "Close Window"]);
+        let mut cursor = PhraseCursor::new();
+
+        assert!(matches(&matcher, &mut cursor, " please").is_empty());
+        assert!(matches(&matcher, &mut cursor, " open").is_empty());
+        assert!(matches(&matcher, &mut cursor, " brow").is_empty());
+        assert!(matches(&matcher, &mut cursor, "ser").is_empty());
+        // Only the longest of the overlapping phrases
+        assert_eq!(
+            matches(&matcher, &mut cursor, " close"),
+            vec!["open browser"]
+        );
+        assert!(matches(&matcher, &mut cursor, " WINDOW").is_empty());
+        assert_eq!(finish(&matcher, &mut cursor), vec!["close window"]);
+    }
+
+    #[test]
+    fn test_phrase_needs_whole_words() {
+        let matcher = PhraseMatcher::new(["pen"]);
+        let mut cursor = PhraseCursor::new();
+
+        assert!(matches(&matcher, &mut cursor, " open").is_empty());
+        assert!(matches(&matcher, &mut cursor, " pen").is_empty());
+        assert!(matches(&matcher, &mut cursor, "cil").is_empty());
+        assert!(finish(&matcher, &mut cursor).is_empty());
+
+        cursor.retract(1);
+        assert_eq!(matches(&matcher, &mut cursor, "."), vec!["pen"]);
+    }
+
+    #[test]
+    fn test_prefix_phrase_waits_for_longer_one() {
+        let matcher = PhraseMatcher::new(["open", "open browser"]);
+        let mut cursor = PhraseCursor::new();
+
+        assert!(matches(&matcher, &mut cursor, " opening").is_empty());
+        assert!(matches(&matcher, &mut cursor, " open").is_empty());
+        assert!(matches(&matcher, &mut cursor, " browser").is_empty());
+        assert_eq!(finish(&matcher, &mut cursor), vec!["open browser"]);
+
+        // Reported with where it ended once the next word rules out the
+        // longer phrase
+        cursor.reset();
+        matches(&matcher, &mut cursor, " open");
+        let mut found = Vec::new();
+        cursor.push(&matcher, " bro", |i, end| found.push((i, end)));
+        assert!(found.is_empty());
+        cursor.push(&matcher, "ken", |i, end| found.push((i, end)));
+        assert_eq!(found, vec![(0, 1)]);
+    }
+
+    #[test]
+    fn test_retracted_tokens_are_not_reported_twice() {
+        let matcher = PhraseMatcher::new(["next tab", "next page"]);
+        let mut cursor = PhraseCursor::new();
+
+        matches(&matcher, &mut cursor, " next");
+        matches(&matcher, &mut cursor, " tab");
+        assert_eq!(matches(&matcher, &mut cursor, " please"), vec!["next tab"]);
+
+        cursor.retract(1);
+        assert_eq!(cursor.len(), 2);
+        assert!(matches(&matcher, &mut cursor, " please").is_empty());
+
+        cursor.retract(2);
+        assert!(matches(&matcher, &mut cursor, " page").is_empty());
+        assert_eq!(finish(&matcher, &mut cursor), vec!["next page"]);
+
+        cursor.reset();
+        matches(&matcher, &mut cursor, " next");
+        matches(&matcher, &mut cursor, " tab");
+        assert_eq!(finish(&matcher, &mut cursor), vec!["next tab"]);
+    }
+}
@@ -0,0 +1,364 @@
+use anyhow::{anyhow, bail, Context, Result};
+use serde::{Deserialize, Serialize};
+use std::io::{self, BufRead, BufReader, BufWriter, Read, Write};
+use std::net::{TcpListener, TcpStream};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::mpsc::{sync_channel, Receiver, Sender, SyncSender, TrySendError};
+use std::sync::Arc;
+use std::thread;
+use tempest_client::{
+    FeatureExtractor, Model, Session, SessionEvent, SessionOptions, Token, TokenFlagBits, TokenView,
+};
+
+use crate::TranscriptDelta;
+
+// Anything larger is a peer speaking another protocol
+const MAX_PACKET_SIZE: usize = 1 << 20;
+
+// Packets queued between the audio callback and the socket, around a
+// second of audio at typical callback sizes
+const PACKET_QUEUE: usize = 100;
+
+// Frames read from the extractor into one packet at most
+const PACKET_FRAMES: usize = 64;
+
+/// First packet from the edge. Features must be computed by the same model
+/// as the server's, which the frame size only roughly checks
+#[derive(Serialize, Deserialize)]
+struct Hello {
+    frame_size: usize,
+    hotwords: Vec<String>,
+}
+
+#[derive(Serialize, Deserialize)]
+struct WireToken {
+    token: String,
+    logprob: f32,
+    /// The library's flag bits, see [`TokenView::flag_bits`]
+    flags: u32,
+    time_ms: usize,
+}
+
+/// A [`TranscriptDelta`] as one JSON line from the server
+#[derive(Serialize, Deserialize)]
+struct WireDelta {
+    retracted: usize,
+    appended: Vec<WireToken>,
+    finalized: usize,
+}
+
+impl From<&TokenView> for WireToken {
+    fn from(token: &TokenView) -> Self {
+        WireToken {
+            token: token.token().into_owned(),
+            logprob: token.logprob(),
+            flags: token.flag_bits(),
+            time_ms: token.time_ms(),
+        }
+    }
+}
+
+impl From<WireToken> for Token {
+    fn from(token: WireToken) -> Self {
+        let flags = TokenFlagBits::from_bits(token.flags);
+        Token::from_parts(token.token, token.logprob, flags, token.time_ms)
+    }
+}
+
+// Packets are a u32 little endian length and the payload. From the edge, an
+// empty packet flushes the current result
+fn write_packet(w: &mut impl Write, payload: &[u8]) -> io::Result<()> {
+    w.write_all(&(payload.len() as u32).to_le_bytes())?;
+    w.write_all(payload)?;
+    w.flush()
+}
+
+// Returns false if the peer closed the connection between packets
+fn read_packet(r: &mut impl Read, payload: &mut Vec<u8>) -> Result<bool> {
+    let mut len = [0u8; 4];
+    match r.read_exact(&mut len) {
+        Ok(()) => {}
+        Err(e) if e.kind() == io::ErrorKind::UnexpectedEof => return Ok(false),
+        Err(e) => return Err(e.into()),
+    }
+
+    let len = u32::from_le_bytes(len) as usize;
+    if len > MAX_PACKET_SIZE {
+        bail!("packet of {len} bytes is too large");
+    }
+    payload.resize(len, 0);
+    r.read_exact(payload)?;
+    Ok(true)
+}
+
+/// Runs a lightweight session for every edge which connects to `addr`,
+/// recognizing the features it streams and sending the results back.
+/// Sessions share the model and run on the connection's thread, so one
+/// server handles as many edges as it has cores to spare.
+pub fn serve(model: &'static Model, model_path: &str, addr: &str) -> Result<()> {
+    let frame_size = FeatureExtractor::new(model_path, 0)
+        .map_err(|e| anyhow!("failed to read the model's features: {e}"))?
+        .frame_size();
+
+    let listener =
+        TcpListener::bind(addr).with_context(|| format!("failed to listen on {addr}"))?;
+    log::info!("serving speech recognition on {}", listener.local_addr()?);
+
+    for stream in listener.incoming() {
+        let stream = match stream {
+            Ok(stream) => stream,
+            Err(e) => {
+                log::warn!("failed to accept a connection: {e}");
+                continue;
+            }
+        };
+
+        thread::spawn(move || {
+            let peer = stream
+                .peer_addr()
+                .map_or_else(|_| "unknown".to_string(), |addr| addr.to_string());
+            log::info!("edge {peer} connected");
+            match serve_edge(model, frame_size, stream) {
+                Ok(()) => log::info!("edge {peer} disconnected"),
+                Err(e) => log::warn!("edge {peer} dropped: {e}"),
+            }
+        });
+    }
+    Ok(())
+}
+
+fn serve_edge(model: &'static Model, frame_size: usize, stream: TcpStream) -> Result<()> {
+    stream.set_nodelay(true)?;
+    let mut reader = BufReader::new(stream.try_clone()?);
+    let mut packet = Vec::new();
+    if !read_packet(&mut reader, &mut packet)? {
+        return Ok(());
+    }
+
+    let hello: Hello = serde_json::from_slice(&packet).context("invalid hello")?;
+    if hello.frame_size != frame_size {
+        bail!(
+            "frames of {} bytes don't match the model's {frame_size}, is the edge using another model?",
+            hello.frame_size
+        );
+    }
+
+    // The handler runs while features are fed on this thread, so the
+    // results go out in order without any locking
+    let mut writer = BufWriter::new(stream);
+    let options = SessionOptions::new().lightweight(true).beam_search(4);
+    let session = Session::with_delta_handler(model, &options, move |event| {
+        let SessionEvent::Delta(delta) = event else {
+            return;
+        };
+        let wire = WireDelta {
+            retracted: delta.retracted,
+            appended: delta.appended.iter().map(WireToken::from).collect(),
+            finalized: delta.finalized,
+        };
+        // A broken connection shows up on the next read
+        let _ = serde_json::to_writer(&mut writer, &wire)
+            .map_err(io::Error::from)
+            .and_then(|()| writer.write_all(b"\n"))
+            .and_then(|()| writer.flush());
+    })
+    .map_err(|e| anyhow!("failed to create a session: {e}"))?;
+
+    let hotwords: Vec<(&str, f32)> = hello
+        .hotwords
+        .iter()
+        .map(|phrase| (phrase.as_str(), 2.0))
+        .collect();
+    if let Err(e) = session.set_hotwords(&hotwords) {
+        log::warn!("unable to set the edge's hotwords: {e}");
+    }
+
+    while read_packet(&mut reader, &mut packet)? {
+        if packet.is_empty() {
+            session.flush();
+            continue;
+        }
+        session
+            .feed_features(&packet)
+            .map_err(|e| anyhow!("invalid features: {e}"))?;
+    }
+    session.flush();
+    Ok(())
+}
+
+/// The edge's end of [`serve`]. Computes the features of captured audio
+/// and queues them for a thread which streams them to the server, while
+/// another gives the server's results to `session_tx` as a local session
+/// would.
+pub struct FeatureStream {
+    extractor: FeatureExtractor,
+    packet_size: usize,
+    // The packet being filled. Sent packets come back through `free` once
+    // written, so the audio callback never allocates. Buffers taken from
+    // `free` for packets which couldn't be sent go back through `recycle`
+    packet: Vec<u8>,
+    free: Receiver<Vec<u8>>,
+    recycle: SyncSender<Vec<u8>>,
+    packets: SyncSender<Vec<u8>>,
+    // Packets dropped since the writer last reported them
+    dropped: Arc<AtomicUsize>,
+}
+
+impl FeatureStream {
+    pub fn connect(
+        addr: &str,
+        model_path: &str,
+        input_rate: usize,
+        hotwords: Vec<String>,
+        session_tx: Sender<TranscriptDelta>,
+    ) -> Result<Self> {
+        let extractor = FeatureExtractor::new(model_path, input_rate)
+            .map_err(|e| anyhow!("failed to create the feature extractor: {e}"))?;
+
+        let stream = TcpStream::connect(addr)
+            .with_context(|| format!("failed to connect to the recognition server at {addr}"))?;
+        stream.set_nodelay(true)?;
+
+        let mut writer = BufWriter::new(stream.try_clone()?);
+        let hello = Hello {
+            frame_size: extractor.frame_size(),
+            hotwords,
+        };
+        write_packet(&mut writer, &serde_json::to_vec(&hello)?)?;
+
+        // One buffer more than the queue holds is always being filled
+        let packet_size = extractor.frame_size() * PACKET_FRAMES;
+        let (free_tx, free) = sync_channel::<Vec<u8>>(PACKET_QUEUE);
+        for _ in 0..PACKET_QUEUE {
+            free_tx.send(Vec::with_capacity(packet_size))?;
+        }
+
+        let recycle = free_tx.clone();
+
+        let dropped = Arc::new(AtomicUsize::new(0));
+        let writer_dropped = dropped.clone();
+        let (packets, packet_rx) = sync_channel::<Vec<u8>>(PACKET_QUEUE);
+        thread::spawn(move || {
+            for mut packet in packet_rx {
+                if let Err(e) = write_packet(&mut writer, &packet) {
+                    log::error!("lost the recognition server: {e}");
+                    return;
+                }
+                packet.clear();
+                let _ = free_tx.try_send(packet);
+
+                let dropped = writer_dropped.swap(0, Ordering::Relaxed);
+                if dropped > 0 {
+                    log::warn!(
+                        "the recognition server can't keep up, dropped {dropped} packets of features"
+                    );
+                }
+            }
+        });
+
+        thread::spawn(move || {
+            for line in BufReader::new(stream).lines() {
+                let delta = line
+                    .map_err(anyhow::Error::from)
+                    .and_then(|line| Ok(serde_json::from_str::<WireDelta>(&line)?));
+                let delta = match delta {
+                    Ok(delta) => delta,
+                    Err(e) => {
+                        log::error!("lost the recognition server: {e}");
+                        return;
+                    }
+                };
+
+                // The receiver only goes away when the process exits
+                let _ = session_tx.send(TranscriptDelta {
+                    retracted: delta.retracted,
+                    appended: delta.appended.into_iter().map(Token::from).collect(),
+                    finalized: delta.finalized,
+                });
+            }
+            log::error!("the recognition server closed the connection");
+        });
+
+        Ok(FeatureStream {
+            extractor,
+            packet_size,
+            packet: Vec::with_capacity(packet_size),
+            free,
+            recycle,
+            packets,
+            dropped,
+        })
+    }
+
+    /// Feeds captured audio at the rate given to [`FeatureStream::connect`].
+    /// Never blocks, so it can be called from the audio callback. If the
+    /// connection can't keep up, features are dropped, and the writer
+    /// reports how many once it catches up.
+    pub fn feed(&mut self, samples: &[f32]) {
+        self.extractor.feed_float(samples);
+        loop {
+            self.packet.resize(self.packet_size, 0);
+            let len = self.extractor.read_frames(&mut self.packet);
+            if len == 0 {
+                return;
+            }
+            self.packet.truncate(len);
+
+            // Every buffer is queued, so the connection is behind
+            let Ok(next) = self.free.try_recv() else {
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+                continue;
+            };
+            let packet = std::mem::replace(&mut self.packet, next);
+            let unsent = match self.packets.try_send(packet) {
+                Ok(()) => continue,
+                Err(TrySendError::Full(packet)) => {
+                    self.dropped.fetch_add(1, Ordering::Relaxed);
+                    packet
+                }
+                // The writer has already reported the lost server
+                Err(TrySendError::Disconnected(packet)) => packet,
+            };
+            // Keeps filling the unsent buffer and returns the one taken for
+            // the next packet, which always fits as it just left `free`
+            let next = std::mem::replace(&mut self.packet, unsent);
+            let _ = self.recycle.try_send(next);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_packets_round_trip() {
+        let mut wire = Vec::new();
+        write_packet(&mut wire, b"features").unwrap();
+        write_packet(&mut wire, b"").unwrap();
+
+        let mut reader = io::Cursor::new(wire);
+        let mut packet = Vec::new();
+        assert!(read_packet(&mut reader, &mut packet).unwrap());
+        assert_eq!(packet, b"features");
+        assert!(read_packet(&mut reader, &mut packet).unwrap());
+        assert!(packet.is_empty());
+        assert!(!read_packet(&mut reader, &mut packet).unwrap());
+
+        let mut huge = io::Cursor::new(u32::MAX.to_le_bytes().to_vec());
+        assert!(read_packet(&mut huge, &mut packet).is_err());
+    }
+
+    #[test]
+    fn test_wire_flags_keep_combined_bits() {
+        let wire: WireToken =
+            serde_json::from_str(r#"{"token":" end.","logprob":-0.5,"flags":3,"time_ms":1200}"#)
+                .unwrap();
+        assert_eq!(Token::from(wire).flags(), TokenFlagBits::SentenceEnd);
+
+        let wire: WireToken =
+            serde_json::from_str(r#"{"token":" word","logprob":0.0,"flags":1,"time_ms":0}"#)
+                .unwrap();
+        assert_eq!(Token::from(wire).flags(), TokenFlagBits::WordBoundary);
+    }
+}
@@ -1,11 +1,12 @@
-use std::sync::mpsc::Sender;
+use crate::llm::Prompt;
+use tokio::sync::mpsc::UnboundedSender;
 pub struct State {
     pub length: usize,
     pub already_commanded: bool,
     pub switched_modes: bool,
     pub listening: bool,
     pub infer: bool,
-    pub to_ollama: Option<Sender<String>>,
+    pub to_ollama: Option<UnboundedSender<Prompt>>,
 }
 
 impl Default for State {
@@ -29,7 +30,15 @@ impl State {
         self.switched_modes = false;
     }
 
-    pub fn ollama_channel(&mut self, sender: Sender<String>) {
+    pub fn ollama_channel(&mut self, sender: UnboundedSender<Prompt>) {
         self.to_ollama.replace(sender);
     }
+
+    pub fn prompt_ollama(&self, prompt: Prompt) {
+        self.to_ollama
+            .as_ref()
+            .expect("could not get a handle to prompt sender channel")
+            .send(prompt)
+            .unwrap_or_else(|_| panic!("failed to send proompt"));
+    }
 }
@@ -1,17 +1,24 @@
 use aes_gcm::{
-    aead::{Aead, KeyInit, Nonce, OsRng},
+    aead::{rand_core::RngCore, Aead, KeyInit, Nonce, OsRng},
     Aes256Gcm,
 };
-use anyhow::Result;
+use anyhow::{bail, Context, Result};
 use std::fs::{self, File, Permissions};
-use std::io::{prelude::*, BufReader};
+use std::io::BufReader;
 use std::os::unix::fs::PermissionsExt;
-use std::os::unix::net::UnixListener;
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::sync::{Arc, Mutex};
+use std::thread;
+use std::time::Duration;
+use tempest_protocol as protocol;
 use virtualdevice::VirtualInput;
 
 mod config;
 mod virtualdevice;
 
+// An unauthenticated client doesn't get to hold a connection open
+const HANDSHAKE_TIMEOUT: Duration = Duration::from_secs(5);
+
 fn main() -> Result<()> {
     env_logger::init();
     let socket_path = "/run/tempest.socket";
@@ -29,42 +36,90 @@ fn main() -> Result<()> {
         let reader = File::open("config.yml")?;
         serde_yaml::from_reader(reader)?
     };
-    let conf: config::Config = conf.into();
-    let mut device = VirtualInput::new()?;
+    let conf: Arc<config::Config> = Arc::new(conf.into());
+    let device = Arc::new(Mutex::new(VirtualInput::new()?));
 
-    loop {
-        log::info!("listening for connections");
-        match listener.accept() {
-            Ok((socket, addr)) => {
-                log::info!("Got a client: {:?} - {:?}", socket.peer_addr(), addr);
-                let mut reader = BufReader::new(&socket);
-                let mut response = String::new();
-                while let Ok(bytes_read) = reader.read_line(&mut response) {
-                    if bytes_read == 0 {
-                        log::info!("Got an end of stream");
-                        break;
-                    }
-                    let bytes = hex::decode(&response.trim())?;
-                    let nonce_bytes = &bytes[..12];
-                    let ciphertext = &bytes[12..];
+    log::info!("listening for connections");
+    for socket in listener.incoming() {
+        let socket = match socket {
+            Ok(socket) => socket,
+            Err(e) => {
+                log::error!("accept function failed: {:?}", e);
+                continue;
+            }
+        };
 
-                    log::debug!("nonce: {nonce_bytes:?}");
-                    log::debug!("ciphertext: {ciphertext:?}");
-                    let nonce = Nonce::<Aes256Gcm>::clone_from_slice(nonce_bytes);
-                    let Ok(resp) = cipher.decrypt(&nonce, ciphertext.as_ref()) else {
-                        log::error!("failed to decrypt ciphertext sent by client");
-                        continue;
-                    };
-                    let resp = std::str::from_utf8(&resp)?;
-                    if let Some(config::Action::Keys(keys)) = conf.actions.get(resp) {
-                        device.key_chord(keys.as_slice());
-                    }
-                    response = String::new();
-                }
+        // Each client gets its own thread, so a slow handshake doesn't hold
+        // up the others. Only writing to the device is serialized
+        let (cipher, conf, device) = (cipher.clone(), conf.clone(), device.clone());
+        thread::spawn(move || {
+            log::info!("Got a client: {:?}", socket.peer_addr());
+            match serve_client(socket, &cipher, &conf, &device) {
+                Ok(()) => log::info!("Got an end of stream"),
+                Err(e) => log::error!("dropped client: {e}"),
             }
-            Err(e) => log::error!("accept function failed: {:?}", e),
-        }
+        });
+    }
+
+    Ok(())
+}
+
+fn serve_client(
+    socket: UnixStream,
+    cipher: &Aes256Gcm,
+    conf: &config::Config,
+    device: &Mutex<VirtualInput>,
+) -> Result<()> {
+    let mut writer = socket.try_clone()?;
+    let mut reader = BufReader::new(socket);
+
+    let mut challenge = [0u8; protocol::CHALLENGE_SIZE];
+    OsRng.fill_bytes(&mut challenge);
+    protocol::write_frame(&mut writer, &challenge)?;
+
+    reader.get_ref().set_read_timeout(Some(HANDSHAKE_TIMEOUT))?;
+    let mut frame = Vec::new();
+    if !protocol::read_frame(&mut reader, &mut frame)? {
+        return Ok(());
+    }
+    if frame.len() < protocol::NONCE_SIZE {
+        bail!("handshake is too short");
     }
+    let (nonce_bytes, ciphertext) = frame.split_at(protocol::NONCE_SIZE);
+    let nonce = Nonce::<Aes256Gcm>::clone_from_slice(nonce_bytes);
+    let Ok(handshake) = cipher.decrypt(&nonce, ciphertext) else {
+        bail!("failed to decrypt the handshake sent by client");
+    };
+    let Some(phrases) = handshake.strip_prefix(&challenge[..]) else {
+        bail!("handshake answers another challenge");
+    };
+    let phrases = std::str::from_utf8(phrases).context("handshake is not UTF-8")?;
 
+    // Phrases are looked up once, after which the client sends ids
+    let chords: Vec<Option<&[u16]>> = phrases
+        .lines()
+        .map(|phrase| match conf.actions.get(phrase) {
+            Some(config::Action::Keys(keys)) => Some(keys.as_slice()),
+            _ => {
+                log::warn!("client's binding `{phrase}` is not a keys action in config.yml");
+                None
+            }
+        })
+        .collect();
+    reader.get_ref().set_read_timeout(None)?;
+    protocol::write_frame(&mut writer, &[protocol::ACCEPTED])?;
+    log::info!("client authenticated with {} key bindings", chords.len());
+
+    while protocol::read_frame(&mut reader, &mut frame)? {
+        let batch = frame.chunks_exact(2).filter_map(|id| {
+            let id = u16::from_le_bytes([id[0], id[1]]) as usize;
+            let chord = chords.get(id).copied().flatten();
+            if chord.is_none() {
+                log::debug!("ignoring unknown chord {id}");
+            }
+            chord
+        });
+        device.lock().unwrap().key_chords(batch);
+    }
     Ok(())
 }
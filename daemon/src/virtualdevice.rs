@@ -3,22 +3,35 @@ use log::error;
 use mouse_keyboard_input::VirtualDevice;
 pub struct VirtualInput(VirtualDevice);
 
+const EV_KEY: u16 = 1;
+const KEY_PRESS: i32 = 1;
+const KEY_RELEASE: i32 = 0;
+
 impl VirtualInput {
     pub fn new() -> Result<Self> {
         let device = VirtualDevice::default()
             .map_err(|e| anyhow!("failed to create global uinput virtual device: {e}"))?;
         Ok(Self(device))
     }
-    pub fn key_chord(&mut self, keys: &[u16]) {
-        for &key in keys {
-            if let Err(e) = self.0.press(key) {
-                error!("failed to press key {key}: {e}");
+
+    /// Presses and releases each chord in turn. The key events of all
+    /// chords are written back to back and reported with a single SYN, so
+    /// a batch reaches the compositor as one input frame.
+    pub fn key_chords<'a>(&mut self, chords: impl IntoIterator<Item = &'a [u16]>) {
+        for keys in chords {
+            for &key in keys {
+                if let Err(e) = self.0.write(EV_KEY, key, KEY_PRESS) {
+                    error!("failed to press key {key}: {e}");
+                }
             }
-        }
-        for &key in keys.iter().rev() {
-            if let Err(e) = self.0.release(key) {
-                error!("failed to release key {key}: {e}");
+            for &key in keys.iter().rev() {
+                if let Err(e) = self.0.write(EV_KEY, key, KEY_RELEASE) {
+                    error!("failed to release key {key}: {e}");
+                }
             }
         }
+        if let Err(e) = self.0.synchronize() {
+            error!("failed to report key events: {e}");
+        }
     }
 }
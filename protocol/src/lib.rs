@@ -0,0 +1,44 @@
+//! How `tempest-client` talks to `tempest-daemon`, shared by both so they
+//! frame messages the same way.
+//!
+//! Frames are a u32 little endian length and the payload. On connecting,
+//! the daemon sends a random challenge. The client answers with a nonce and
+//! the challenge followed by the phrases of its key bindings, one per line,
+//! encrypted with the daemon's token. The n-th phrase is then chord n, and
+//! every further frame is a batch of u16 little endian chord ids.
+use anyhow::{bail, Result};
+use std::io::{self, Read, Write};
+
+pub const CHALLENGE_SIZE: usize = 32;
+pub const NONCE_SIZE: usize = 12;
+
+/// Sent back to the client once its handshake is accepted
+pub const ACCEPTED: u8 = 0;
+
+// Handshakes are the largest frames, a few bytes per configured phrase
+const MAX_FRAME_SIZE: usize = 1 << 16;
+
+pub fn write_frame(w: &mut impl Write, payload: &[u8]) -> io::Result<()> {
+    let mut frame = Vec::with_capacity(4 + payload.len());
+    frame.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+    frame.extend_from_slice(payload);
+    w.write_all(&frame)
+}
+
+/// Returns false if the peer closed the connection between frames
+pub fn read_frame(r: &mut impl Read, payload: &mut Vec<u8>) -> Result<bool> {
+    let mut len = [0u8; 4];
+    match r.read_exact(&mut len) {
+        Ok(()) => {}
+        Err(e) if e.kind() == io::ErrorKind::UnexpectedEof => return Ok(false),
+        Err(e) => return Err(e.into()),
+    }
+
+    let len = u32::from_le_bytes(len) as usize;
+    if len > MAX_FRAME_SIZE {
+        bail!("frame of {len} bytes is too large");
+    }
+    payload.resize(len, 0);
+    r.read_exact(payload)?;
+    Ok(true)
+}